@@ -0,0 +1,88 @@
+// Host energy model, see energy.h.
+#include "energy.h"
+
+// Default costs: a wakeup keeps the CPU up for a few milliseconds, a log
+// line goes out over Bluetooth, the motor draws tens of milliamps and a
+// persist write may erase flash.
+double energy_costs[ENERGY_TERMS] = {
+  [ENERGY_WAKEUP] = 150,
+  [ENERGY_TICK] = 40,
+  [ENERGY_INVALIDATION] = 20,
+  [ENERGY_REDRAW] = 10,
+  [ENERGY_LOG] = 300,
+  [ENERGY_VIBE] = 200,
+  [ENERGY_PERSIST] = 1500,
+  [ENERGY_ACCEL] = 15,
+};
+
+static const char *energy_names[ENERGY_TERMS] = {
+  [ENERGY_WAKEUP] = "wakeup",
+  [ENERGY_TICK] = "tick",
+  [ENERGY_INVALIDATION] = "inval",
+  [ENERGY_REDRAW] = "redraw_kpx",
+  [ENERGY_LOG] = "log",
+  [ENERGY_VIBE] = "vibe_ms",
+  [ENERGY_PERSIST] = "persist",
+  [ENERGY_ACCEL] = "accel",
+};
+
+const char *energy_term_name(enum energy_term term){
+  return energy_names[term];
+}
+
+bool energy_set_costs(const char *spec){
+  double costs[ENERGY_TERMS];
+  char copy[256];
+  char *save = NULL;
+
+  if (strlen(spec) >= sizeof(copy)){
+    return false;
+  }
+  memcpy(costs, energy_costs, sizeof(costs));
+  strcpy(copy, spec);
+
+  for (char *item = strtok_r(copy, ",", &save); item; item = strtok_r(NULL, ",", &save)){
+    char *value = strchr(item, '=');
+    char *end;
+    int term;
+
+    if (!value){
+      return false;
+    }
+    *value++ = '\0';
+    for (term = 0; term < ENERGY_TERMS && strcmp(item, energy_names[term]) != 0; term++){
+    }
+    if (term == ENERGY_TERMS){
+      return false;
+    }
+    costs[term] = strtod(value, &end);
+    if (end == value || *end != '\0' || costs[term] < 0){
+      return false;
+    }
+  }
+
+  memcpy(energy_costs, costs, sizeof(costs));
+  return true;
+}
+
+void energy_account(const struct sim_stats *s, double uj[ENERGY_TERMS]){
+  uj[ENERGY_WAKEUP] = s->wakeups * energy_costs[ENERGY_WAKEUP];
+  uj[ENERGY_TICK] = s->ticks * energy_costs[ENERGY_TICK];
+  uj[ENERGY_INVALIDATION] = s->invalidations * energy_costs[ENERGY_INVALIDATION];
+  uj[ENERGY_REDRAW] = s->redraw_area / 1000.0 * energy_costs[ENERGY_REDRAW];
+  uj[ENERGY_LOG] = s->logs * energy_costs[ENERGY_LOG];
+  uj[ENERGY_VIBE] = s->vibe_ms * energy_costs[ENERGY_VIBE];
+  uj[ENERGY_PERSIST] = s->persist_writes * energy_costs[ENERGY_PERSIST];
+  uj[ENERGY_ACCEL] = s->accel_samples * energy_costs[ENERGY_ACCEL];
+}
+
+double energy_total_uj(const struct sim_stats *s){
+  double uj[ENERGY_TERMS];
+  double total = 0;
+
+  energy_account(s, uj);
+  for (int term = 0; term < ENERGY_TERMS; term++){
+    total += uj[term];
+  }
+  return total;
+}
@@ -0,0 +1,33 @@
+// Energy model of the host simulator: what a run would have drawn from the
+// watch's battery, worked out from its sim_stats counters, each weighted by
+// a cost in microjoules. The costs are rough figures for an aplite Pebble,
+// meant to compare builds and modes, not to predict battery life; any of
+// them can be set on the command line (rc_sim -e wakeup=200,log=0).
+#pragma once
+
+#include "sim.h"
+
+enum energy_term {
+  ENERGY_WAKEUP,        // per CPU wakeup
+  ENERGY_TICK,          // per tick handler run
+  ENERGY_INVALIDATION,  // per layer invalidation
+  ENERGY_REDRAW,        // per 1000 pixels redrawn
+  ENERGY_LOG,           // per APP_LOG call
+  ENERGY_VIBE,          // per millisecond of the vibration motor
+  ENERGY_PERSIST,       // per persist write
+  ENERGY_ACCEL,         // per accelerometer sample
+  ENERGY_TERMS,
+};
+
+// Costs in microjoules per unit of each term.
+extern double energy_costs[ENERGY_TERMS];
+
+const char *energy_term_name(enum energy_term term);
+
+// Sets costs from "name=cost,name=cost". Returns false, changing nothing,
+// on an unknown name or a bad cost.
+bool energy_set_costs(const char *spec);
+
+// Microjoules each term of the run cost, and their sum.
+void energy_account(const struct sim_stats *s, double uj[ENERGY_TERMS]);
+double energy_total_uj(const struct sim_stats *s);
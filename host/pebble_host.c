@@ -0,0 +1,2185 @@
+// Host implementation of the Pebble API stand-in declared in pebble.h.
+//
+// Time is virtual: nothing sleeps, the clock jumps from one due event to the
+// next, so a 60 minute workout runs in milliseconds. Every service call the
+// app makes is counted in sim_stats.
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "sim.h"
+
+#define SCREEN_WIDTH 144
+#define SCREEN_HEIGHT 168
+#define MAX_WINDOWS 8
+#define MAX_PERSIST_KEYS 128
+#define MAX_WAKEUPS 8
+#define MAX_WORKER_MESSAGES 8
+#define SIM_VIBE_MAX_SEGMENTS 32
+
+// Persistent storage the watch gives an app.
+#define SIM_PERSIST_MAX_BYTES 4096
+
+// AppMessage link to the phone stand-in: a message takes this long to get
+// across and be acknowledged, about what AppMessage manages over Bluetooth,
+// and each side has one message in flight at a time.
+#define SIM_LINK_MS 50
+#define SIM_APP_MESSAGE_MAX 2044
+
+// Where appinfo.json resources live, set by the build.
+#ifndef SIM_RESOURCES_DIR
+#define SIM_RESOURCES_DIR "resources"
+#endif
+
+// App heap on aplite, what is left of the app's 24 KB once its code, data
+// and bss are loaded is less.
+#define SIM_HEAP_BYTES (24 * 1024)
+
+// Virtual epoch: 2014-08-19 06:00:00 UTC.
+#define SIM_EPOCH_MS 1408428000000ULL
+
+enum layer_kind {
+  LAYER_KIND_PLAIN,
+  LAYER_KIND_TEXT,
+  LAYER_KIND_MENU,
+};
+
+struct Layer {
+  GRect frame;
+  bool hidden;
+  bool dirty;
+  enum layer_kind kind;
+  LayerUpdateProc update_proc;
+  void *data;
+  Layer *parent;
+  Layer *first_child;
+  Layer *next_sibling;
+};
+
+struct TextLayer {
+  Layer layer;
+  const char *text;
+  GFont font;
+  GTextAlignment alignment;
+};
+
+// Rows come from the app's callbacks; only the first section is shown.
+struct MenuLayer {
+  Layer layer;
+  MenuLayerCallbacks callbacks;
+  void *context;
+  uint16_t selected_row;
+  uint16_t top_row;
+};
+
+// A menu cell keeps the text drawn into it so the harness can read rows
+// back. Custom layers fill rectangles into the framebuffer, offset to the
+// layer and clipped to it; text is not rasterized.
+struct GContext {
+  char title[64];
+  char subtitle[64];
+  GColor fill_color;
+  GPoint offset;
+  GRect clip;
+};
+
+// What the top window last painted, true for black.
+static bool framebuffer[SCREEN_HEIGHT][SCREEN_WIDTH];
+
+struct click_handlers {
+  ClickHandler single;
+  ClickHandler long_down;
+  ClickHandler long_up;
+};
+
+struct Window {
+  Layer root;
+  WindowHandlers handlers;
+  ClickConfigProvider click_config_provider;
+  void *click_context;
+  struct click_handlers clicks[NUM_BUTTONS];
+  MenuLayer *menu;
+  bool loaded;
+  bool needs_full_redraw;
+};
+
+struct AppTimer {
+  uint64_t fire_at;
+  uint32_t seq;
+  AppTimerCallback callback;
+  void *data;
+  AppTimer *next;
+};
+
+// Resources from appinfo.json, loaded from disk on first use.
+struct sim_resource {
+  uint32_t id;
+  const char *file;
+  uint8_t *data;
+  size_t size;
+};
+
+static struct sim_resource resources[] = {
+  { RESOURCE_ID_MENU_ICON, "images/main_menu_icon.png", NULL, 0 },
+  { RESOURCE_ID_PROGRAMS, "data/programs.bin", NULL, 0 },
+};
+
+// Persistent storage and wakeups outlive a launch, like on the watch.
+struct sim_persist {
+  bool used;
+  uint32_t key;
+  size_t size;
+  uint8_t data[PERSIST_DATA_MAX_LENGTH];
+};
+
+struct sim_wakeup {
+  bool used;
+  WakeupId id;
+  time_t timestamp;
+  int32_t cookie;
+};
+
+static struct sim_persist persist[MAX_PERSIST_KEYS];
+static struct sim_wakeup wakeups[MAX_WAKEUPS];
+static WakeupId wakeup_next_id = 1;
+
+// How the running app was launched.
+static AppLaunchReason app_launch_reason = APP_LAUNCH_USER;
+static struct sim_wakeup launch_wakeup;
+
+struct sim_stats sim_stats;
+struct sim_latency sim_latencies[SIM_MAX_LATENCIES];
+int sim_latency_count = 0;
+int sim_inputs_pending = 0;
+
+// Presses waiting for a frame, when they came.
+static struct {
+  uint64_t ms;
+  struct timespec host;
+} inputs[SIM_MAX_LATENCIES];
+bool sim_verbose = false;
+
+static uint64_t now_ms = SIM_EPOCH_MS;
+static uint64_t last_wakeup_ms = UINT64_MAX;
+
+static Window *window_stack[MAX_WINDOWS];
+static int window_stack_size = 0;
+
+// Window whose click config provider is currently running.
+static Window *configuring_window = NULL;
+
+static TickHandler tick_handler = NULL;
+static TimeUnits tick_units = 0;
+static uint64_t tick_next_ms = 0;
+
+static AppTimer *timers = NULL;
+static uint32_t timer_seq = 0;
+
+// Blocks of the app heap, the UI objects the app created and its own
+// malloc, and the bytes they hold. The system frees what is left when the
+// app exits.
+struct sim_block {
+  struct sim_block *next;
+  struct sim_block *prev;
+  size_t size;
+} __attribute__((aligned(16)));
+
+static struct sim_block *heap_blocks = NULL;
+static size_t heap_used = 0;
+
+// Accelerometer: a batch every samples_per_update samples, taken at the
+// sampling rate from the trace the harness plays, looped, or from a still
+// wrist. Taps only come from the harness.
+static AccelDataHandler accel_handler = NULL;
+static uint32_t accel_batch = 0;
+static AccelSamplingRate accel_rate = ACCEL_SAMPLING_25HZ;
+static uint64_t accel_next_ms = 0;
+static const int16_t (*accel_trace)[3] = NULL;
+static uint32_t accel_trace_length = 0;
+static uint32_t accel_trace_hz = 0;
+static uint64_t accel_trace_start_ms = 0;
+static AccelTapHandler accel_tap_handler = NULL;
+
+// Battery: full and unplugged until the harness says otherwise, across
+// launches.
+static BatteryChargeState battery = { .charge_percent = 100 };
+static BatteryStateHandler battery_handler = NULL;
+
+// What the motor plays and since when, for vibes_cancel to cut short.
+static struct {
+  uint64_t start_ms;
+  uint32_t segments[SIM_VIBE_MAX_SEGMENTS];
+  uint32_t count;
+} vibe;
+
+static void (*launch_script)(void *ctx) = NULL;
+static void *launch_ctx = NULL;
+static struct timespec launch_started;
+
+// Set once the app empties its window stack.
+static bool app_exited = false;
+
+// Between the app's launch and its exit.
+static bool app_up = false;
+
+// A message on its way over the link.
+struct sim_message {
+  bool pending;
+  uint64_t at;
+  uint16_t size;
+  uint8_t data[SIM_APP_MESSAGE_MAX];
+};
+
+static struct sim_message to_phone;
+static struct sim_message to_watch;
+static bool link_up = true;
+static SimPhoneReceived phone_received;
+static SimPhoneSent phone_sent;
+
+// The app's end of AppMessage.
+static bool app_message_opened = false;
+static uint32_t app_message_inbox_size;
+static uint32_t app_message_outbox_size;
+static uint8_t app_message_outbox[SIM_APP_MESSAGE_MAX];
+static DictionaryIterator app_message_outbox_iter;
+static bool app_message_writing = false;
+static void *app_message_context;
+static AppMessageInboxReceived app_message_inbox_received;
+static AppMessageInboxDropped app_message_inbox_dropped;
+static AppMessageOutboxSent app_message_outbox_sent;
+static AppMessageOutboxFailed app_message_outbox_failed;
+
+// The background worker, while running: a thread of its own, blocked in
+// worker_event_loop() from its launch to its kill. Its callbacks run on the
+// harness thread like the app's, one side at a time; in_worker tells whose
+// calls are being made. The watch runs one worker at a time, the slot is
+// taken by another app's unless the harness frees it.
+static bool worker_slot_free = false;
+static bool worker_running = false;
+static bool in_worker = false;
+static pthread_t worker_thread;
+static sem_t worker_in_loop;
+static sem_t worker_quit;
+static AppTimer *worker_timers = NULL;
+static AppWorkerMessageHandler worker_handler = NULL;
+static AppWorkerMessageHandler app_worker_handler = NULL;
+
+// The worker asked for the app while it was closed.
+static bool worker_wants_app = false;
+
+// AppWorkerMessages on their way, delivered by the next dispatch.
+struct sim_worker_message {
+  bool to_worker;
+  uint16_t type;
+  AppWorkerMessage data;
+};
+
+static struct sim_worker_message worker_messages[MAX_WORKER_MESSAGES];
+static int worker_message_count = 0;
+
+///////////////////////////////////////////////////////////////////////////////
+/*                                  HELPERS                                  */
+///////////////////////////////////////////////////////////////////////////////
+static void note_wakeup(void){
+  if (last_wakeup_ms != now_ms){
+    last_wakeup_ms = now_ms;
+    sim_stats.wakeups++;
+  }
+}
+
+static uint64_t unit_ms(TimeUnits units){
+  if (units & SECOND_UNIT){
+    return 1000;
+  } else if (units & MINUTE_UNIT){
+    return 60 * 1000;
+  } else if (units & HOUR_UNIT){
+    return 60 * 60 * 1000;
+  }
+  return 24 * 60 * 60 * 1000;
+}
+
+static uint64_t next_boundary(uint64_t t, uint64_t unit){
+  return (t / unit + 1) * unit;
+}
+
+static void layer_init(Layer *layer, GRect frame, enum layer_kind kind){
+  sim_stats.layers_created++;
+  memset(layer, 0, sizeof(*layer));
+  layer->frame = frame;
+  layer->kind = kind;
+}
+
+// Area of a layer once clipped to the screen.
+static uint64_t clipped_area(int x, int y, int w, int h){
+  int x0 = x < 0 ? 0 : x;
+  int y0 = y < 0 ? 0 : y;
+  int x1 = x + w > SCREEN_WIDTH ? SCREEN_WIDTH : x + w;
+  int y1 = y + h > SCREEN_HEIGHT ? SCREEN_HEIGHT : y + h;
+
+  if (x1 <= x0 || y1 <= y0){
+    return 0;
+  }
+  return (uint64_t)(x1 - x0) * (uint64_t)(y1 - y0);
+}
+
+static uint64_t render_layer_discard(Layer *layer){
+  layer->dirty = false;
+  for (Layer *child = layer->first_child; child; child = child->next_sibling){
+    render_layer_discard(child);
+  }
+  return 0;
+}
+
+// Visible layers a frame left alone, and their area.
+struct render_skipped {
+  uint32_t layers;
+  uint64_t area;
+};
+
+// A redrawn layer starts from the window's white background, then its
+// update proc paints over it.
+static void render_update(Layer *layer, int x, int y){
+  GContext ctx = {
+    .fill_color = GColorBlack,
+    .offset = { x, y },
+    .clip = GRect(x, y, layer->frame.size.w, layer->frame.size.h),
+  };
+
+  graphics_context_set_fill_color(&ctx, GColorWhite);
+  graphics_fill_rect(&ctx, layer_get_bounds(layer), 0, GCornerNone);
+  ctx.fill_color = GColorBlack;
+  if (layer->update_proc){
+    layer->update_proc(layer, layer->kind == LAYER_KIND_PLAIN ? &ctx : NULL);
+  }
+}
+
+// Walks a layer tree, returns the dirty area and clears the dirty flags.
+static uint64_t render_layer(Layer *layer, int x, int y, bool full, bool *drawn, struct render_skipped *skipped){
+  uint64_t area = 0;
+  bool redraw = !layer->hidden && (full || layer->dirty);
+
+  x += layer->frame.origin.x;
+  y += layer->frame.origin.y;
+
+  if (redraw){
+    area += clipped_area(x, y, layer->frame.size.w, layer->frame.size.h);
+    *drawn = true;
+    render_update(layer, x, y);
+  } else if (!layer->hidden && layer->parent){
+    skipped->layers++;
+    skipped->area += clipped_area(x, y, layer->frame.size.w, layer->frame.size.h);
+  }
+  layer->dirty = false;
+
+  // Children of a hidden layer are not drawn, but lose their dirty state.
+  for (Layer *child = layer->first_child; child; child = child->next_sibling){
+    area += layer->hidden ? render_layer_discard(child) : render_layer(child, x, y, redraw, drawn, skipped);
+  }
+  return area;
+}
+
+static void note_input(void){
+  if (sim_inputs_pending < SIM_MAX_LATENCIES){
+    inputs[sim_inputs_pending].ms = now_ms;
+    clock_gettime(CLOCK_MONOTONIC, &inputs[sim_inputs_pending].host);
+    sim_inputs_pending++;
+  }
+}
+
+// A frame answers every press since the last one.
+static void answer_inputs(void){
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  for (int i = 0; i < sim_inputs_pending && sim_latency_count < SIM_MAX_LATENCIES; i++){
+    sim_latencies[sim_latency_count++] = (struct sim_latency){
+      .ms = (uint32_t)(now_ms - inputs[i].ms),
+      .ns = (uint64_t)(now.tv_sec - inputs[i].host.tv_sec) * 1000000000ULL + now.tv_nsec - inputs[i].host.tv_nsec,
+    };
+  }
+  sim_inputs_pending = 0;
+}
+
+// Renders the top window the way the compositor does at the end of an event.
+static void render(void){
+  Window *top = window_stack_get_top_window();
+  struct render_skipped skipped = { 0 };
+  bool drawn = false;
+
+  if (!top){
+    return;
+  }
+
+  sim_stats.redraw_area += render_layer(&top->root, 0, 0, top->needs_full_redraw, &drawn, &skipped);
+  top->needs_full_redraw = false;
+
+  if (drawn){
+    sim_stats.frames++;
+    sim_stats.skipped_layers += skipped.layers;
+    sim_stats.skipped_area += skipped.area;
+    answer_inputs();
+  }
+}
+
+static void configure_clicks(Window *window){
+  memset(window->clicks, 0, sizeof(window->clicks));
+  if (window->click_config_provider){
+    configuring_window = window;
+    window->click_config_provider(window->click_context ? window->click_context : window);
+    configuring_window = NULL;
+  }
+}
+
+static void window_became_top(Window *window){
+  window->needs_full_redraw = true;
+  configure_clicks(window);
+  if (window->handlers.appear){
+    window->handlers.appear(window);
+  }
+}
+
+static Layer *find_layer(Layer *layer, enum layer_kind kind, int *n){
+  if (layer->kind == kind && (*n)-- == 0){
+    return layer;
+  }
+  for (Layer *child = layer->first_child; child; child = child->next_sibling){
+    Layer *found = find_layer(child, kind, n);
+    if (found){
+      return found;
+    }
+  }
+  return NULL;
+}
+
+static Layer *find_top_layer(enum layer_kind kind, int n){
+  Window *top = window_stack_get_top_window();
+  return top ? find_layer(&top->root, kind, &n) : NULL;
+}
+
+static void drop_worker_messages(bool to_worker);
+
+static void reset_services(void){
+  tick_handler = NULL;
+  tick_units = 0;
+  accel_handler = NULL;
+  accel_rate = ACCEL_SAMPLING_25HZ;
+  accel_tap_handler = NULL;
+  battery_handler = NULL;
+  vibe.count = 0;
+  while (timers){
+    AppTimer *next = timers->next;
+    sim_app_free(timers);
+    timers = next;
+  }
+  while (heap_blocks){
+    sim_app_free(heap_blocks + 1);
+  }
+  window_stack_size = 0;
+
+  // Whatever was on its way to the app is lost with it.
+  app_worker_handler = NULL;
+  drop_worker_messages(false);
+  app_message_deregister_callbacks();
+  app_message_opened = false;
+  app_message_writing = false;
+  to_phone.pending = false;
+  if (to_watch.pending){
+    to_watch.pending = false;
+    if (phone_sent){
+      phone_sent(false);
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/*                                   MEMORY                                  */
+///////////////////////////////////////////////////////////////////////////////
+void *sim_app_malloc(size_t size){
+  return sim_app_calloc(1, size);
+}
+
+// Fails like the watch once the heap is used up.
+void *sim_app_calloc(size_t count, size_t size){
+  struct sim_block *block;
+
+  if (heap_used + count * size > SIM_HEAP_BYTES){
+    return NULL;
+  }
+  block = calloc(1, sizeof(struct sim_block) + count * size);
+  block->size = count * size;
+  block->next = heap_blocks;
+  block->prev = NULL;
+  if (heap_blocks){
+    heap_blocks->prev = block;
+  }
+  heap_blocks = block;
+
+  heap_used += block->size;
+  if (heap_used > sim_stats.heap_peak){
+    sim_stats.heap_peak = heap_used;
+  }
+  return block + 1;
+}
+
+void sim_app_free(void *ptr){
+  struct sim_block *block = (struct sim_block *)ptr - 1;
+
+  if (!ptr){
+    return;
+  }
+  if (block->prev){
+    block->prev->next = block->next;
+  } else {
+    heap_blocks = block->next;
+  }
+  if (block->next){
+    block->next->prev = block->prev;
+  }
+  heap_used -= block->size;
+  free(block);
+}
+
+size_t heap_bytes_used(void){
+  return heap_used;
+}
+
+size_t heap_bytes_free(void){
+  return SIM_HEAP_BYTES - heap_used;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/*                                  GRAPHICS                                 */
+///////////////////////////////////////////////////////////////////////////////
+GFont fonts_get_system_font(const char *font_key){
+  return (GFont)font_key;
+}
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color){
+  ctx->fill_color = color;
+}
+
+// Fills with square corners whatever the radius, the harness only reads
+// pixels well inside the shapes. The background a redraw starts from is not
+// counted as the app's.
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask){
+  int x0 = ctx->offset.x + rect.origin.x;
+  int y0 = ctx->offset.y + rect.origin.y;
+  int x1 = x0 + rect.size.w;
+  int y1 = y0 + rect.size.h;
+
+  x0 = x0 < ctx->clip.origin.x ? ctx->clip.origin.x : x0;
+  y0 = y0 < ctx->clip.origin.y ? ctx->clip.origin.y : y0;
+  x1 = x1 > ctx->clip.origin.x + ctx->clip.size.w ? ctx->clip.origin.x + ctx->clip.size.w : x1;
+  y1 = y1 > ctx->clip.origin.y + ctx->clip.size.h ? ctx->clip.origin.y + ctx->clip.size.h : y1;
+  x0 = x0 < 0 ? 0 : x0;
+  y0 = y0 < 0 ? 0 : y0;
+  x1 = x1 > SCREEN_WIDTH ? SCREEN_WIDTH : x1;
+  y1 = y1 > SCREEN_HEIGHT ? SCREEN_HEIGHT : y1;
+  if (x1 <= x0 || y1 <= y0 || ctx->fill_color == GColorClear){
+    return;
+  }
+
+  for (int y = y0; y < y1; y++){
+    memset(&framebuffer[y][x0], ctx->fill_color == GColorBlack, x1 - x0);
+  }
+  if (ctx->fill_color == GColorBlack){
+    sim_stats.filled_area += (uint64_t)(x1 - x0) * (y1 - y0);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/*                                   LAYERS                                  */
+///////////////////////////////////////////////////////////////////////////////
+Layer *layer_create(GRect frame){
+  Layer *layer = sim_app_malloc(sizeof(Layer));
+  if (!layer){
+    return NULL;
+  }
+  layer_init(layer, frame, LAYER_KIND_PLAIN);
+  return layer;
+}
+
+// The data lives right after the layer, in the same block.
+Layer *layer_create_with_data(GRect frame, size_t data_size){
+  Layer *layer = sim_app_calloc(1, sizeof(Layer) + data_size);
+  if (!layer){
+    return NULL;
+  }
+  layer_init(layer, frame, LAYER_KIND_PLAIN);
+  layer->data = layer + 1;
+  return layer;
+}
+
+void *layer_get_data(const Layer *layer){
+  return layer->data;
+}
+
+void layer_destroy(Layer *layer){
+  layer_remove_from_parent(layer);
+  sim_app_free(layer);
+}
+
+void layer_mark_dirty(Layer *layer){
+  sim_stats.invalidations++;
+  layer->dirty = true;
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc){
+  layer->update_proc = update_proc;
+}
+
+void layer_set_frame(Layer *layer, GRect frame){
+  layer->frame = frame;
+  layer_mark_dirty(layer);
+}
+
+GRect layer_get_frame(const Layer *layer){
+  return layer->frame;
+}
+
+GRect layer_get_bounds(const Layer *layer){
+  return (GRect){ .origin = { 0, 0 }, .size = layer->frame.size };
+}
+
+void layer_add_child(Layer *parent, Layer *child){
+  Layer **link = &parent->first_child;
+
+  layer_remove_from_parent(child);
+  while (*link){
+    link = &(*link)->next_sibling;
+  }
+  *link = child;
+  child->parent = parent;
+  child->next_sibling = NULL;
+}
+
+void layer_remove_from_parent(Layer *child){
+  if (!child->parent){
+    return;
+  }
+  for (Layer **link = &child->parent->first_child; *link; link = &(*link)->next_sibling){
+    if (*link == child){
+      *link = child->next_sibling;
+      break;
+    }
+  }
+  child->parent = NULL;
+  child->next_sibling = NULL;
+}
+
+void layer_set_hidden(Layer *layer, bool hidden){
+  if (layer->hidden != hidden){
+    layer->hidden = hidden;
+    if (layer->parent){
+      layer_mark_dirty(layer->parent);
+    }
+  }
+}
+
+bool layer_get_hidden(const Layer *layer){
+  return layer->hidden;
+}
+
+TextLayer *text_layer_create(GRect frame){
+  TextLayer *text_layer = sim_app_calloc(1, sizeof(TextLayer));
+  if (!text_layer){
+    return NULL;
+  }
+  layer_init(&text_layer->layer, frame, LAYER_KIND_TEXT);
+  return text_layer;
+}
+
+void text_layer_destroy(TextLayer *text_layer){
+  layer_destroy(&text_layer->layer);
+}
+
+Layer *text_layer_get_layer(TextLayer *text_layer){
+  return &text_layer->layer;
+}
+
+void text_layer_set_text(TextLayer *text_layer, const char *text){
+  text_layer->text = text;
+  layer_mark_dirty(&text_layer->layer);
+}
+
+const char *text_layer_get_text(TextLayer *text_layer){
+  return text_layer->text;
+}
+
+void text_layer_set_font(TextLayer *text_layer, GFont font){
+  text_layer->font = font;
+  layer_mark_dirty(&text_layer->layer);
+}
+
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment text_alignment){
+  text_layer->alignment = text_alignment;
+  layer_mark_dirty(&text_layer->layer);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/*                                   MENUS                                   */
+///////////////////////////////////////////////////////////////////////////////
+static uint16_t menu_rows(MenuLayer *menu){
+  return menu->callbacks.get_num_rows ? menu->callbacks.get_num_rows(menu, 0, menu->context) : 0;
+}
+
+static int16_t menu_cell_height(MenuLayer *menu, uint16_t row){
+  MenuIndex index = { 0, row };
+  return menu->callbacks.get_cell_height ? menu->callbacks.get_cell_height(menu, &index, menu->context) : MENU_CELL_BASIC_CELL_HEIGHT;
+}
+
+// Draws one row through the app's callback into a scratch cell.
+static void menu_draw_cell(MenuLayer *menu, uint16_t row, GContext *ctx){
+  MenuIndex index = { 0, row };
+  Layer cell = { .frame = GRect(0, 0, menu->layer.frame.size.w, menu_cell_height(menu, row)), .kind = LAYER_KIND_PLAIN };
+
+  memset(ctx, 0, sizeof(*ctx));
+  sim_stats.cells_drawn++;
+  if (menu->callbacks.draw_row){
+    menu->callbacks.draw_row(ctx, &cell, &index, menu->context);
+  }
+}
+
+// Draws the rows in view, as the firmware does: nothing else is asked of the
+// app however long the menu is.
+static void menu_layer_update_proc(Layer *layer, GContext *unused){
+  MenuLayer *menu = (MenuLayer *)layer;
+  uint16_t rows = menu_rows(menu);
+  GContext ctx;
+
+  for (int row = menu->top_row, y = 0; row < rows && y < layer->frame.size.h; row++){
+    menu_draw_cell(menu, (uint16_t)row, &ctx);
+    y += menu_cell_height(menu, (uint16_t)row);
+  }
+}
+
+// Moves the selection, scrolling just enough to keep it in view.
+static void menu_select_row(MenuLayer *menu, int row){
+  uint16_t rows = menu_rows(menu);
+  uint16_t old_row = menu->selected_row;
+  int height = 0;
+
+  if (row < 0 || row >= rows){
+    return;
+  }
+  menu->selected_row = (uint16_t)row;
+  if (menu->selected_row < menu->top_row){
+    menu->top_row = menu->selected_row;
+  }
+  for (int r = menu->selected_row; r >= menu->top_row; r--){
+    height += menu_cell_height(menu, (uint16_t)r);
+    if (height > menu->layer.frame.size.h){
+      menu->top_row = (uint16_t)(r + 1);
+      break;
+    }
+  }
+  if (menu->selected_row != old_row){
+    layer_mark_dirty(&menu->layer);
+    if (menu->callbacks.selection_changed){
+      menu->callbacks.selection_changed(menu, (MenuIndex){ 0, menu->selected_row }, (MenuIndex){ 0, old_row }, menu->context);
+    }
+  }
+}
+
+static void menu_click(MenuLayer *menu, ButtonId button, bool long_click){
+  MenuIndex index = { 0, menu->selected_row };
+
+  if (button == BUTTON_ID_UP){
+    menu_select_row(menu, menu->selected_row - 1);
+  } else if (button == BUTTON_ID_DOWN){
+    menu_select_row(menu, menu->selected_row + 1);
+  } else if (menu->selected_row < menu_rows(menu)){
+    MenuLayerSelectCallback select = long_click ? menu->callbacks.select_long_click : menu->callbacks.select_click;
+    if (select){
+      select(menu, &index, menu->context);
+    }
+  }
+}
+
+MenuLayer *menu_layer_create(GRect frame){
+  MenuLayer *menu = sim_app_calloc(1, sizeof(MenuLayer));
+  if (!menu){
+    return NULL;
+  }
+  layer_init(&menu->layer, frame, LAYER_KIND_MENU);
+  menu->layer.update_proc = menu_layer_update_proc;
+  return menu;
+}
+
+void menu_layer_destroy(MenuLayer *menu_layer){
+  layer_destroy(&menu_layer->layer);
+}
+
+Layer *menu_layer_get_layer(const MenuLayer *menu_layer){
+  return (Layer *)&menu_layer->layer;
+}
+
+void menu_layer_set_callbacks(MenuLayer *menu_layer, void *callback_context, MenuLayerCallbacks callbacks){
+  menu_layer->callbacks = callbacks;
+  menu_layer->context = callback_context;
+  layer_mark_dirty(&menu_layer->layer);
+}
+
+void menu_layer_set_click_config_onto_window(MenuLayer *menu_layer, Window *window){
+  window->menu = menu_layer;
+}
+
+void menu_cell_basic_draw(GContext *ctx, const Layer *cell_layer, const char *title, const char *subtitle, GBitmap *icon){
+  snprintf(ctx->title, sizeof(ctx->title), "%s", title ? title : "");
+  snprintf(ctx->subtitle, sizeof(ctx->subtitle), "%s", subtitle ? subtitle : "");
+}
+
+void menu_layer_reload_data(MenuLayer *menu_layer){
+  uint16_t rows = menu_rows(menu_layer);
+
+  if (menu_layer->selected_row >= rows){
+    menu_layer->selected_row = rows ? rows - 1 : 0;
+  }
+  if (menu_layer->top_row > menu_layer->selected_row){
+    menu_layer->top_row = menu_layer->selected_row;
+  }
+  layer_mark_dirty(&menu_layer->layer);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/*                               WINDOWS & INPUT                             */
+///////////////////////////////////////////////////////////////////////////////
+Window *window_create(void){
+  Window *window = sim_app_calloc(1, sizeof(Window));
+  if (!window){
+    return NULL;
+  }
+  layer_init(&window->root, GRect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT), LAYER_KIND_PLAIN);
+  return window;
+}
+
+void window_destroy(Window *window){
+  for (int i = 0; i < window_stack_size; i++){
+    if (window_stack[i] == window){
+      memmove(&window_stack[i], &window_stack[i + 1], (window_stack_size - i - 1) * sizeof(Window *));
+      window_stack_size--;
+      break;
+    }
+  }
+  if (window->loaded && window->handlers.unload){
+    window->loaded = false;
+    window->handlers.unload(window);
+  }
+  sim_app_free(window);
+}
+
+void window_set_window_handlers(Window *window, WindowHandlers handlers){
+  window->handlers = handlers;
+}
+
+void window_set_click_config_provider(Window *window, ClickConfigProvider click_config_provider){
+  window_set_click_config_provider_with_context(window, click_config_provider, window);
+}
+
+void window_set_click_config_provider_with_context(Window *window, ClickConfigProvider click_config_provider, void *context){
+  window->click_config_provider = click_config_provider;
+  window->click_context = context;
+}
+
+Layer *window_get_root_layer(const Window *window){
+  return (Layer *)&window->root;
+}
+
+bool window_is_loaded(Window *window){
+  return window->loaded;
+}
+
+void window_stack_push(Window *window, bool animated){
+  Window *previous = window_stack_get_top_window();
+
+  if (window_stack_size == MAX_WINDOWS){
+    fprintf(stderr, "sim: window stack overflow\n");
+    abort();
+  }
+  if (previous && previous->handlers.disappear){
+    previous->handlers.disappear(previous);
+  }
+
+  window_stack[window_stack_size++] = window;
+  if (!window->loaded){
+    window->loaded = true;
+    sim_stats.windows_loaded++;
+    if (window->handlers.load){
+      window->handlers.load(window);
+    }
+  }
+  window_became_top(window);
+}
+
+Window *window_stack_pop(bool animated){
+  Window *window;
+  Window *top;
+
+  if (window_stack_size == 0){
+    return NULL;
+  }
+
+  window = window_stack[--window_stack_size];
+  if (window->handlers.disappear){
+    window->handlers.disappear(window);
+  }
+  if (window->loaded){
+    window->loaded = false;
+    if (window->handlers.unload){
+      window->handlers.unload(window);
+    }
+  }
+
+  top = window_stack_get_top_window();
+  if (top){
+    window_became_top(top);
+  } else if (launch_script){
+    app_exited = true;
+  }
+  return window;
+}
+
+void window_stack_pop_all(const bool animated){
+  while (window_stack_size > 0){
+    window_stack_pop(animated);
+  }
+}
+
+bool window_stack_remove(Window *window, bool animated){
+  int i;
+
+  for (i = 0; i < window_stack_size && window_stack[i] != window; i++){
+  }
+  if (i == window_stack_size){
+    return false;
+  }
+  if (i == window_stack_size - 1){
+    window_stack_pop(animated);
+    return true;
+  }
+
+  memmove(&window_stack[i], &window_stack[i + 1], (window_stack_size - i - 1) * sizeof(Window *));
+  window_stack_size--;
+  if (window->loaded){
+    window->loaded = false;
+    if (window->handlers.unload){
+      window->handlers.unload(window);
+    }
+  }
+  return true;
+}
+
+bool window_stack_contains_window(Window *window){
+  for (int i = 0; i < window_stack_size; i++){
+    if (window_stack[i] == window){
+      return true;
+    }
+  }
+  return false;
+}
+
+Window *window_stack_get_top_window(void){
+  return window_stack_size ? window_stack[window_stack_size - 1] : NULL;
+}
+
+void window_single_click_subscribe(ButtonId button_id, ClickHandler handler){
+  configuring_window->clicks[button_id].single = handler;
+}
+
+void window_long_click_subscribe(ButtonId button_id, uint16_t delay_ms, ClickHandler down_handler, ClickHandler up_handler){
+  configuring_window->clicks[button_id].long_down = down_handler;
+  configuring_window->clicks[button_id].long_up = up_handler;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/*                                TIME & TIMERS                              */
+///////////////////////////////////////////////////////////////////////////////
+void tick_timer_service_subscribe(TimeUnits tick_units_, TickHandler handler){
+  sim_stats.timer_calls++;
+  tick_handler = handler;
+  tick_units = tick_units_;
+  tick_next_ms = next_boundary(now_ms, unit_ms(tick_units));
+}
+
+void tick_timer_service_unsubscribe(void){
+  sim_stats.timer_calls++;
+  tick_handler = NULL;
+  tick_units = 0;
+}
+
+// The worker's timers are its own, out of its own heap, and not counted
+// against the app.
+static AppTimer **timer_list(void){
+  return in_worker ? &worker_timers : &timers;
+}
+
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data){
+  AppTimer *timer = in_worker ? calloc(1, sizeof(AppTimer)) : sim_app_calloc(1, sizeof(AppTimer));
+  AppTimer **link = timer_list();
+
+  if (!in_worker){
+    sim_stats.timer_calls++;
+  }
+  if (!timer){
+    return NULL;
+  }
+  timer->fire_at = now_ms + timeout_ms;
+  timer->seq = timer_seq++;
+  timer->callback = callback;
+  timer->data = callback_data;
+
+  // Keep the list sorted by deadline, registration order breaks ties.
+  while (*link && (*link)->fire_at <= timer->fire_at){
+    link = &(*link)->next;
+  }
+  timer->next = *link;
+  *link = timer;
+  return timer;
+}
+
+static bool unlink_timer(AppTimer *timer_handle){
+  for (AppTimer **link = timer_list(); *link; link = &(*link)->next){
+    if (*link == timer_handle){
+      *link = timer_handle->next;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms){
+  AppTimer **link = timer_list();
+
+  if (!in_worker){
+    sim_stats.timer_calls++;
+  }
+  if (!unlink_timer(timer_handle)){
+    return false;
+  }
+  timer_handle->fire_at = now_ms + new_timeout_ms;
+  while (*link && (*link)->fire_at <= timer_handle->fire_at){
+    link = &(*link)->next;
+  }
+  timer_handle->next = *link;
+  *link = timer_handle;
+  return true;
+}
+
+void app_timer_cancel(AppTimer *timer_handle){
+  if (!in_worker){
+    sim_stats.timer_calls++;
+  }
+  if (unlink_timer(timer_handle)){
+    if (in_worker){
+      free(timer_handle);
+    } else {
+      sim_app_free(timer_handle);
+    }
+  }
+}
+
+time_t sim_time(time_t *tloc){
+  time_t t = (time_t)(now_ms / 1000);
+  if (tloc){
+    *tloc = t;
+  }
+  return t;
+}
+
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms){
+  uint16_t ms = (uint16_t)(now_ms % 1000);
+  sim_time(tloc);
+  if (out_ms){
+    *out_ms = ms;
+  }
+  return ms;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/*                                  VIBES                                    */
+///////////////////////////////////////////////////////////////////////////////
+// The system pulses, on and off in milliseconds, taken to last as long as
+// src/buzz.h takes them to.
+static const uint32_t vibe_short[] = { 100 };
+static const uint32_t vibe_long[] = { 500 };
+static const uint32_t vibe_double[] = { 100, 100, 100 };
+
+static void vibe_play(const uint32_t *durations, uint32_t count){
+  if (count > SIM_VIBE_MAX_SEGMENTS){
+    count = SIM_VIBE_MAX_SEGMENTS;
+  }
+  memcpy(vibe.segments, durations, count * sizeof(*durations));
+  vibe.count = count;
+  vibe.start_ms = now_ms;
+  for (uint32_t i = 0; i < count; i += 2){
+    sim_stats.vibe_ms += durations[i];
+  }
+}
+
+void vibes_short_pulse(void){
+  sim_stats.vibes_short++;
+  vibe_play(vibe_short, 1);
+}
+
+void vibes_long_pulse(void){
+  sim_stats.vibes_long++;
+  vibe_play(vibe_long, 1);
+}
+
+void vibes_double_pulse(void){
+  sim_stats.vibes_double++;
+  vibe_play(vibe_double, 3);
+}
+
+void vibes_enqueue_custom_pattern(VibePattern pattern){
+  sim_stats.vibes_custom++;
+  vibe_play(pattern.durations, pattern.num_segments);
+}
+
+// The motor stops: the time it would still have been on is not spent.
+void vibes_cancel(void){
+  uint64_t end_ms = vibe.start_ms;
+
+  sim_stats.vibes_cancelled++;
+  for (uint32_t i = 0; i < vibe.count; i++){
+    uint64_t start_ms = end_ms;
+
+    end_ms += vibe.segments[i];
+    if (i % 2 == 0 && end_ms > now_ms){
+      sim_stats.vibe_ms -= (uint32_t)(end_ms - (start_ms > now_ms ? start_ms : now_ms));
+    }
+  }
+  vibe.count = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/*                               ACCELEROMETER                               */
+///////////////////////////////////////////////////////////////////////////////
+static uint64_t accel_batch_ms(void){
+  return (uint64_t)accel_batch * 1000 / accel_rate;
+}
+
+void accel_data_service_subscribe(uint32_t samples_per_update, AccelDataHandler handler){
+  accel_handler = handler;
+  accel_batch = samples_per_update ? samples_per_update : 1;
+  accel_next_ms = now_ms + accel_batch_ms();
+}
+
+void accel_data_service_unsubscribe(void){
+  accel_handler = NULL;
+}
+
+int accel_service_set_sampling_rate(AccelSamplingRate rate){
+  accel_rate = rate;
+  if (accel_handler){
+    accel_next_ms = now_ms + accel_batch_ms();
+  }
+  return 0;
+}
+
+void accel_tap_service_subscribe(AccelTapHandler handler){
+  accel_tap_handler = handler;
+}
+
+void accel_tap_service_unsubscribe(void){
+  accel_tap_handler = NULL;
+}
+
+void sim_accel_play(const int16_t (*xyz)[3], uint32_t count, uint32_t rate_hz){
+  accel_trace = count && rate_hz ? xyz : NULL;
+  accel_trace_length = count;
+  accel_trace_hz = rate_hz;
+  accel_trace_start_ms = now_ms;
+}
+
+void sim_accel_tap(AccelAxisType axis, int32_t direction){
+  note_wakeup();
+  if (accel_tap_handler){
+    sim_stats.accel_taps++;
+    accel_tap_handler(axis, direction);
+  }
+  render();
+}
+
+void battery_state_service_subscribe(BatteryStateHandler handler){
+  battery_handler = handler;
+}
+
+void battery_state_service_unsubscribe(void){
+  battery_handler = NULL;
+}
+
+BatteryChargeState battery_state_service_peek(void){
+  return battery;
+}
+
+void sim_battery_set(uint8_t percent, bool charging){
+  battery = (BatteryChargeState){ .charge_percent = percent, .is_charging = charging, .is_plugged = charging };
+  if (battery_handler){
+    note_wakeup();
+    battery_handler(battery);
+    render();
+  }
+}
+
+// Hands the samples taken since the last batch to the app, each the one of
+// the trace at its time.
+static void deliver_accel(void){
+  AccelData *batch = calloc(accel_batch, sizeof(AccelData));
+  uint64_t first_ms = now_ms - accel_batch_ms();
+
+  for (uint32_t i = 0; i < accel_batch; i++){
+    batch[i].timestamp = first_ms + (uint64_t)(i + 1) * 1000 / accel_rate;
+    if (accel_trace){
+      uint64_t n = (batch[i].timestamp - accel_trace_start_ms) * accel_trace_hz / 1000 % accel_trace_length;
+
+      batch[i].x = accel_trace[n][0];
+      batch[i].y = accel_trace[n][1];
+      batch[i].z = accel_trace[n][2];
+    } else {
+      batch[i].z = -1000;
+    }
+  }
+
+  accel_next_ms = now_ms + accel_batch_ms();
+  sim_stats.accel_batches++;
+  sim_stats.accel_samples += accel_batch;
+  accel_handler(batch, accel_batch);
+  free(batch);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/*                                  LOGGING                                  */
+///////////////////////////////////////////////////////////////////////////////
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...){
+  sim_stats.logs++;
+
+  if (sim_verbose){
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "[%llu] %s:%d ", (unsigned long long)(now_ms - SIM_EPOCH_MS), src_filename, src_line_number);
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/*                                 RESOURCES                                 */
+///////////////////////////////////////////////////////////////////////////////
+ResHandle resource_get_handle(uint32_t resource_id){
+  for (size_t i = 0; i < sizeof(resources) / sizeof(resources[0]); i++){
+    struct sim_resource *resource = &resources[i];
+    char path[512];
+    FILE *f;
+
+    if (resource->id != resource_id){
+      continue;
+    }
+    if (!resource->data){
+      snprintf(path, sizeof(path), "%s/%s", SIM_RESOURCES_DIR, resource->file);
+      if (!(f = fopen(path, "rb"))){
+        fprintf(stderr, "sim: cannot open resource %s\n", path);
+        abort();
+      }
+      fseek(f, 0, SEEK_END);
+      resource->size = (size_t)ftell(f);
+      fseek(f, 0, SEEK_SET);
+      resource->data = malloc(resource->size);
+      if (fread(resource->data, 1, resource->size, f) != resource->size){
+        abort();
+      }
+      fclose(f);
+    }
+    return resource;
+  }
+  return NULL;
+}
+
+size_t resource_size(ResHandle h){
+  return h ? ((const struct sim_resource *)h)->size : 0;
+}
+
+size_t resource_load_byte_range(ResHandle h, uint32_t start_offset, uint8_t *buffer, size_t num_bytes){
+  const struct sim_resource *resource = h;
+
+  if (!resource || start_offset >= resource->size){
+    return 0;
+  }
+  if (num_bytes > resource->size - start_offset){
+    num_bytes = resource->size - start_offset;
+  }
+  memcpy(buffer, resource->data + start_offset, num_bytes);
+  sim_stats.resource_bytes += num_bytes;
+  return num_bytes;
+}
+
+size_t resource_load(ResHandle h, uint8_t *buffer, size_t max_length){
+  return resource_load_byte_range(h, 0, buffer, max_length);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/*                                  STORAGE                                  */
+///////////////////////////////////////////////////////////////////////////////
+static struct sim_persist *persist_find(uint32_t key){
+  for (int i = 0; i < MAX_PERSIST_KEYS; i++){
+    if (persist[i].used && persist[i].key == key){
+      return &persist[i];
+    }
+  }
+  return NULL;
+}
+
+bool persist_exists(const uint32_t key){
+  return persist_find(key) != NULL;
+}
+
+int persist_get_size(const uint32_t key){
+  struct sim_persist *entry = persist_find(key);
+
+  return entry ? (int)entry->size : E_DOES_NOT_EXIST;
+}
+
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size){
+  struct sim_persist *entry = persist_find(key);
+  size_t size;
+
+  sim_stats.persist_reads++;
+  if (!entry){
+    return E_DOES_NOT_EXIST;
+  }
+  size = entry->size < buffer_size ? entry->size : buffer_size;
+  memcpy(buffer, entry->data, size);
+  return (int)size;
+}
+
+uint32_t sim_persist_used(void){
+  uint32_t used = 0;
+
+  for (int i = 0; i < MAX_PERSIST_KEYS; i++){
+    used += persist[i].used ? persist[i].size : 0;
+  }
+  return used;
+}
+
+int persist_write_data(const uint32_t key, const void *data, const size_t size){
+  struct sim_persist *entry = persist_find(key);
+  size_t written = size < PERSIST_DATA_MAX_LENGTH ? size : PERSIST_DATA_MAX_LENGTH;
+
+  if (sim_persist_used() - (entry ? entry->size : 0) + written > SIM_PERSIST_MAX_BYTES){
+    return E_OUT_OF_STORAGE;
+  }
+
+  for (int i = 0; !entry && i < MAX_PERSIST_KEYS; i++){
+    if (!persist[i].used){
+      entry = &persist[i];
+      entry->used = true;
+      entry->key = key;
+    }
+  }
+  if (!entry){
+    return E_OUT_OF_STORAGE;
+  }
+
+  memcpy(entry->data, data, written);
+  entry->size = written;
+  sim_stats.persist_writes++;
+  sim_stats.persist_bytes += written;
+  return (int)written;
+}
+
+status_t persist_delete(const uint32_t key){
+  struct sim_persist *entry = persist_find(key);
+
+  if (!entry){
+    return E_DOES_NOT_EXIST;
+  }
+  entry->used = false;
+  return S_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/*                                  WAKEUP                                   */
+///////////////////////////////////////////////////////////////////////////////
+static struct sim_wakeup *wakeup_find(WakeupId wakeup_id){
+  for (int i = 0; i < MAX_WAKEUPS; i++){
+    if (wakeups[i].used && wakeups[i].id == wakeup_id){
+      return &wakeups[i];
+    }
+  }
+  return NULL;
+}
+
+WakeupId wakeup_schedule(time_t timestamp, int32_t cookie, bool notify_if_missed){
+  if (timestamp <= (time_t)(now_ms / 1000)){
+    return E_RANGE;
+  }
+  for (int i = 0; i < MAX_WAKEUPS; i++){
+    if (!wakeups[i].used){
+      wakeups[i] = (struct sim_wakeup){ true, wakeup_next_id++, timestamp, cookie };
+      return wakeups[i].id;
+    }
+  }
+  return E_OUT_OF_RESOURCES;
+}
+
+void wakeup_cancel(WakeupId wakeup_id){
+  struct sim_wakeup *wakeup = wakeup_find(wakeup_id);
+
+  if (wakeup){
+    wakeup->used = false;
+  }
+}
+
+void wakeup_cancel_all(void){
+  memset(wakeups, 0, sizeof(wakeups));
+}
+
+bool wakeup_query(WakeupId wakeup_id, time_t *timestamp){
+  struct sim_wakeup *wakeup = wakeup_find(wakeup_id);
+
+  if (wakeup && timestamp){
+    *timestamp = wakeup->timestamp;
+  }
+  return wakeup != NULL;
+}
+
+bool wakeup_get_launch_event(WakeupId *wakeup_id, int32_t *cookie){
+  if (app_launch_reason != APP_LAUNCH_WAKEUP){
+    return false;
+  }
+  *wakeup_id = launch_wakeup.id;
+  *cookie = launch_wakeup.cookie;
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/*                                 DICTIONARY                                */
+///////////////////////////////////////////////////////////////////////////////
+// Same layout as on the watch: a tuple count, then the tuples back to back,
+// so message sizes are the real ones.
+struct Dictionary {
+  uint8_t count;
+  uint8_t head[];
+};
+
+static Tuple *tuple_after(const Tuple *tuple){
+  return (Tuple *)((uint8_t *)tuple + sizeof(Tuple) + tuple->length);
+}
+
+uint32_t dict_calc_buffer_size(const uint8_t tuple_count, ...){
+  uint32_t total = sizeof(Dictionary) + tuple_count * sizeof(Tuple);
+  va_list sizes;
+
+  va_start(sizes, tuple_count);
+  for (int i = 0; i < tuple_count; i++){
+    total += va_arg(sizes, unsigned int);
+  }
+  va_end(sizes);
+  return total;
+}
+
+DictionaryResult dict_write_begin(DictionaryIterator *iter, uint8_t * const buffer, const uint16_t size){
+  if (size < sizeof(Dictionary)){
+    return DICT_NOT_ENOUGH_STORAGE;
+  }
+  iter->dictionary = (Dictionary *)buffer;
+  iter->dictionary->count = 0;
+  iter->cursor = (Tuple *)iter->dictionary->head;
+  iter->end = buffer + size;
+  return DICT_OK;
+}
+
+static DictionaryResult dict_write(DictionaryIterator *iter, uint32_t key, TupleType type, const void *value, uint16_t size){
+  Tuple *tuple = iter->cursor;
+
+  if ((uint8_t *)tuple + sizeof(Tuple) + size > (const uint8_t *)iter->end){
+    return DICT_NOT_ENOUGH_STORAGE;
+  }
+  tuple->key = key;
+  tuple->type = type;
+  tuple->length = size;
+  memcpy(tuple->value, value, size);
+  iter->cursor = tuple_after(tuple);
+  iter->dictionary->count++;
+  return DICT_OK;
+}
+
+DictionaryResult dict_write_data(DictionaryIterator *iter, const uint32_t key, const uint8_t * const data, const uint16_t size){
+  return dict_write(iter, key, TUPLE_BYTE_ARRAY, data, size);
+}
+
+DictionaryResult dict_write_uint8(DictionaryIterator *iter, const uint32_t key, const uint8_t value){
+  return dict_write(iter, key, TUPLE_UINT, &value, sizeof(value));
+}
+
+DictionaryResult dict_write_uint16(DictionaryIterator *iter, const uint32_t key, const uint16_t value){
+  return dict_write(iter, key, TUPLE_UINT, &value, sizeof(value));
+}
+
+DictionaryResult dict_write_uint32(DictionaryIterator *iter, const uint32_t key, const uint32_t value){
+  return dict_write(iter, key, TUPLE_UINT, &value, sizeof(value));
+}
+
+uint32_t dict_write_end(DictionaryIterator *iter){
+  iter->end = iter->cursor;
+  return (uint32_t)((uint8_t *)iter->cursor - (uint8_t *)iter->dictionary);
+}
+
+Tuple *dict_read_begin_from_buffer(DictionaryIterator *iter, const uint8_t * const buffer, const uint16_t size){
+  iter->dictionary = (Dictionary *)buffer;
+  iter->end = buffer + size;
+  iter->cursor = (Tuple *)iter->dictionary->head;
+  return size > sizeof(Dictionary) && iter->dictionary->count ? iter->cursor : NULL;
+}
+
+Tuple *dict_read_next(DictionaryIterator *iter){
+  iter->cursor = tuple_after(iter->cursor);
+  return (const void *)iter->cursor < iter->end ? iter->cursor : NULL;
+}
+
+Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key){
+  Tuple *tuple = (Tuple *)iter->dictionary->head;
+
+  for (int i = 0; i < iter->dictionary->count && (const void *)tuple < iter->end; i++){
+    if (tuple->key == key){
+      return tuple;
+    }
+    tuple = tuple_after(tuple);
+  }
+  return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/*                                APP MESSAGE                                */
+///////////////////////////////////////////////////////////////////////////////
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound){
+  if (size_inbound > SIM_APP_MESSAGE_MAX || size_outbound > SIM_APP_MESSAGE_MAX){
+    return APP_MSG_OUT_OF_MEMORY;
+  }
+  app_message_inbox_size = size_inbound;
+  app_message_outbox_size = size_outbound;
+  app_message_opened = true;
+  return APP_MSG_OK;
+}
+
+uint32_t app_message_inbox_size_maximum(void){
+  return SIM_APP_MESSAGE_MAX;
+}
+
+uint32_t app_message_outbox_size_maximum(void){
+  return SIM_APP_MESSAGE_MAX;
+}
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator){
+  if (!app_message_opened){
+    return APP_MSG_CLOSED;
+  }
+  if (to_phone.pending){
+    return APP_MSG_BUSY;
+  }
+  dict_write_begin(&app_message_outbox_iter, app_message_outbox, (uint16_t)app_message_outbox_size);
+  app_message_writing = true;
+  *iterator = &app_message_outbox_iter;
+  return APP_MSG_OK;
+}
+
+AppMessageResult app_message_outbox_send(void){
+  uint32_t size;
+
+  if (!app_message_writing){
+    return APP_MSG_INVALID_ARGS;
+  }
+  size = (uint32_t)((uint8_t *)app_message_outbox_iter.cursor - app_message_outbox);
+  app_message_writing = false;
+
+  to_phone.pending = true;
+  to_phone.at = now_ms + SIM_LINK_MS;
+  to_phone.size = (uint16_t)size;
+  memcpy(to_phone.data, app_message_outbox, size);
+  sim_stats.messages_sent++;
+  return APP_MSG_OK;
+}
+
+void *app_message_set_context(void *context){
+  void *previous = app_message_context;
+  app_message_context = context;
+  return previous;
+}
+
+AppMessageInboxReceived app_message_register_inbox_received(AppMessageInboxReceived received_callback){
+  AppMessageInboxReceived previous = app_message_inbox_received;
+  app_message_inbox_received = received_callback;
+  return previous;
+}
+
+AppMessageInboxDropped app_message_register_inbox_dropped(AppMessageInboxDropped dropped_callback){
+  AppMessageInboxDropped previous = app_message_inbox_dropped;
+  app_message_inbox_dropped = dropped_callback;
+  return previous;
+}
+
+AppMessageOutboxSent app_message_register_outbox_sent(AppMessageOutboxSent sent_callback){
+  AppMessageOutboxSent previous = app_message_outbox_sent;
+  app_message_outbox_sent = sent_callback;
+  return previous;
+}
+
+AppMessageOutboxFailed app_message_register_outbox_failed(AppMessageOutboxFailed failed_callback){
+  AppMessageOutboxFailed previous = app_message_outbox_failed;
+  app_message_outbox_failed = failed_callback;
+  return previous;
+}
+
+void app_message_deregister_callbacks(void){
+  app_message_inbox_received = NULL;
+  app_message_inbox_dropped = NULL;
+  app_message_outbox_sent = NULL;
+  app_message_outbox_failed = NULL;
+  app_message_context = NULL;
+}
+
+// The app's message reaches the phone, or fails if the link is down.
+static void deliver_to_phone(void){
+  DictionaryIterator iter;
+
+  to_phone.pending = false;
+  dict_read_begin_from_buffer(&iter, to_phone.data, to_phone.size);
+  if (link_up && phone_received){
+    phone_received(&iter);
+    if (app_message_outbox_sent){
+      app_message_outbox_sent(&iter, app_message_context);
+    }
+  } else if (app_message_outbox_failed){
+    app_message_outbox_failed(&iter, APP_MSG_NOT_CONNECTED, app_message_context);
+  }
+}
+
+// The phone's message reaches the app's inbox, if it is listening and the
+// message fits.
+static void deliver_to_watch(void){
+  DictionaryIterator iter;
+  bool delivered = link_up && app_message_opened && app_message_inbox_received;
+
+  to_watch.pending = false;
+  if (delivered && to_watch.size > app_message_inbox_size){
+    if (app_message_inbox_dropped){
+      app_message_inbox_dropped(APP_MSG_BUFFER_OVERFLOW, app_message_context);
+    }
+    delivered = false;
+  }
+  if (delivered){
+    sim_stats.messages_received++;
+    sim_stats.message_bytes += to_watch.size;
+    dict_read_begin_from_buffer(&iter, to_watch.data, to_watch.size);
+    app_message_inbox_received(&iter, app_message_context);
+  }
+  if (phone_sent){
+    phone_sent(delivered);
+  }
+}
+
+void sim_link_attach(SimPhoneReceived received, SimPhoneSent sent){
+  phone_received = received;
+  phone_sent = sent;
+}
+
+bool sim_link_send(const uint8_t *data, size_t size){
+  if (to_watch.pending || size > SIM_APP_MESSAGE_MAX){
+    return false;
+  }
+  to_watch.pending = true;
+  to_watch.at = now_ms + SIM_LINK_MS;
+  to_watch.size = (uint16_t)size;
+  memcpy(to_watch.data, data, size);
+  return true;
+}
+
+void sim_link_set_up(bool up){
+  link_up = up;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/*                                   WORKER                                  */
+///////////////////////////////////////////////////////////////////////////////
+static void *worker_thread_main(void *unused){
+  pebble_worker_main();
+  return NULL;
+}
+
+bool app_worker_is_running(void){
+  return worker_running;
+}
+
+// Starts the worker and waits for it to reach its event loop. With the slot
+// taken the watch would ask the user, who is taken to decline.
+AppWorkerResult app_worker_launch(void){
+  if (worker_running){
+    return APP_WORKER_RESULT_ALREADY_RUNNING;
+  }
+  if (!worker_slot_free){
+    return APP_WORKER_RESULT_ASKING_CONFIRMATION;
+  }
+  worker_running = true;
+  in_worker = true;
+  sem_init(&worker_in_loop, 0, 0);
+  sem_init(&worker_quit, 0, 0);
+  pthread_create(&worker_thread, NULL, worker_thread_main, NULL);
+  sem_wait(&worker_in_loop);
+  in_worker = false;
+  return APP_WORKER_RESULT_SUCCESS;
+}
+
+// Lets the worker out of its event loop and waits for it to exit.
+AppWorkerResult app_worker_kill(void){
+  bool was_in_worker = in_worker;
+
+  if (!worker_running){
+    return APP_WORKER_RESULT_NOT_RUNNING;
+  }
+  in_worker = true;
+  sem_post(&worker_quit);
+  pthread_join(worker_thread, NULL);
+  while (worker_timers){
+    AppTimer *next = worker_timers->next;
+    free(worker_timers);
+    worker_timers = next;
+  }
+  in_worker = was_in_worker;
+  sem_destroy(&worker_in_loop);
+  sem_destroy(&worker_quit);
+  worker_handler = NULL;
+  worker_wants_app = false;
+  worker_running = false;
+  drop_worker_messages(true);
+  return APP_WORKER_RESULT_SUCCESS;
+}
+
+void worker_event_loop(void){
+  sem_post(&worker_in_loop);
+  sem_wait(&worker_quit);
+}
+
+// Launches the app once the harness lets the clock run to it, see
+// sim_launch_by_worker. The app already up is left alone.
+void worker_launch_app(void){
+  if (!app_up){
+    worker_wants_app = true;
+  }
+}
+
+bool app_worker_message_subscribe(AppWorkerMessageHandler handler){
+  *(in_worker ? &worker_handler : &app_worker_handler) = handler;
+  return true;
+}
+
+bool app_worker_message_unsubscribe(void){
+  return app_worker_message_subscribe(NULL);
+}
+
+void app_worker_send_message(uint8_t type, AppWorkerMessage *data){
+  if (!worker_running || worker_message_count == MAX_WORKER_MESSAGES){
+    return;
+  }
+  worker_messages[worker_message_count++] = (struct sim_worker_message){ !in_worker, type, *data };
+  sim_stats.worker_messages++;
+}
+
+static void drop_worker_messages(bool to_worker){
+  int kept = 0;
+
+  for (int i = 0; i < worker_message_count; i++){
+    if (worker_messages[i].to_worker != to_worker){
+      worker_messages[kept++] = worker_messages[i];
+    }
+  }
+  worker_message_count = kept;
+}
+
+// Delivers the messages sent so far, a message to the closed app is lost,
+// then fires the worker's timers that are due.
+static void dispatch_worker_due(void){
+  struct sim_worker_message sent[MAX_WORKER_MESSAGES];
+  int count = worker_message_count;
+
+  memcpy(sent, worker_messages, sizeof(sent));
+  worker_message_count = 0;
+  for (int i = 0; i < count; i++){
+    if (sent[i].to_worker && worker_handler){
+      in_worker = true;
+      worker_handler(sent[i].type, &sent[i].data);
+      in_worker = false;
+    } else if (!sent[i].to_worker && app_up && app_worker_handler){
+      app_worker_handler(sent[i].type, &sent[i].data);
+    }
+  }
+
+  while (worker_timers && worker_timers->fire_at <= now_ms){
+    AppTimer *timer = worker_timers;
+    worker_timers = timer->next;
+    sim_stats.worker_timers++;
+    in_worker = true;
+    timer->callback(timer->data);
+    in_worker = false;
+    free(timer);
+  }
+}
+
+static bool next_worker_event(uint64_t *at){
+  if (worker_message_count > 0){
+    *at = now_ms;
+    return true;
+  }
+  if (worker_running && worker_timers){
+    *at = worker_timers->fire_at;
+    return true;
+  }
+  return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/*                                 EVENT LOOP                                */
+///////////////////////////////////////////////////////////////////////////////
+static bool next_event(uint64_t *at){
+  uint64_t worker_at;
+  bool found = false;
+
+  if (app_exited){
+    return false;
+  }
+
+  if (tick_handler){
+    *at = tick_next_ms;
+    found = true;
+  }
+  if (accel_handler && (!found || accel_next_ms < *at)){
+    *at = accel_next_ms;
+    found = true;
+  }
+  if (timers && (!found || timers->fire_at < *at)){
+    *at = timers->fire_at;
+    found = true;
+  }
+  if (to_phone.pending && (!found || to_phone.at < *at)){
+    *at = to_phone.at;
+    found = true;
+  }
+  if (to_watch.pending && (!found || to_watch.at < *at)){
+    *at = to_watch.at;
+    found = true;
+  }
+  if (next_worker_event(&worker_at) && (!found || worker_at < *at)){
+    *at = worker_at;
+    found = true;
+  }
+  return found;
+}
+
+// Fires everything due at the current instant.
+static void dispatch_due(void){
+  note_wakeup();
+
+  if (tick_handler && tick_next_ms == now_ms){
+    time_t t = (time_t)(now_ms / 1000);
+    struct tm tick_time;
+    TimeUnits changed = SECOND_UNIT;
+
+    gmtime_r(&t, &tick_time);
+    if (tick_time.tm_sec == 0){
+      changed |= MINUTE_UNIT;
+      if (tick_time.tm_min == 0){
+        changed |= HOUR_UNIT;
+        if (tick_time.tm_hour == 0){
+          changed |= DAY_UNIT;
+        }
+      }
+    }
+
+    // Handlers only hear about units at or above the subscribed one.
+    changed &= ~(tick_units - 1);
+    tick_next_ms = next_boundary(now_ms, unit_ms(tick_units));
+    sim_stats.ticks++;
+    tick_handler(&tick_time, changed);
+  }
+
+  if (accel_handler && accel_next_ms <= now_ms){
+    deliver_accel();
+  }
+
+  while (timers && timers->fire_at <= now_ms){
+    AppTimer *timer = timers;
+    timers = timer->next;
+    sim_stats.timers++;
+    timer->callback(timer->data);
+    sim_app_free(timer);
+  }
+
+  if (to_phone.pending && to_phone.at <= now_ms){
+    deliver_to_phone();
+  }
+  if (to_watch.pending && to_watch.at <= now_ms){
+    deliver_to_watch();
+  }
+  dispatch_worker_due();
+
+  render();
+}
+
+uint64_t sim_now_ms(void){
+  return now_ms;
+}
+
+void sim_run_for(uint64_t ms){
+  uint64_t end = now_ms + ms;
+  uint64_t at;
+
+  while (next_event(&at) && at <= end){
+    now_ms = at;
+    dispatch_due();
+  }
+  if (!app_exited){
+    now_ms = end;
+  }
+}
+
+bool sim_run_until_idle(uint64_t cap_ms){
+  uint64_t end = now_ms + cap_ms;
+  uint64_t at;
+
+  while (next_event(&at)){
+    if (at > end){
+      now_ms = end;
+      return false;
+    }
+    now_ms = at;
+    dispatch_due();
+  }
+  return true;
+}
+
+void sim_click(ButtonId button){
+  Window *top = window_stack_get_top_window();
+
+  note_wakeup();
+  note_input();
+  if (top && top->menu && button != BUTTON_ID_BACK){
+    menu_click(top->menu, button, false);
+  } else if (top && top->clicks[button].single){
+    top->clicks[button].single(NULL, top->click_context ? top->click_context : top);
+  } else if (button == BUTTON_ID_BACK){
+    window_stack_pop(true);
+  }
+  render();
+}
+
+void sim_long_click(ButtonId button){
+  Window *top = window_stack_get_top_window();
+  void *context;
+
+  note_wakeup();
+  note_input();
+  if (top && top->menu && button != BUTTON_ID_BACK){
+    menu_click(top->menu, button, true);
+  } else if (top){
+    context = top->click_context ? top->click_context : top;
+    if (top->clicks[button].long_down){
+      top->clicks[button].long_down(NULL, context);
+    }
+    if (top->clicks[button].long_up){
+      top->clicks[button].long_up(NULL, context);
+    }
+  }
+  render();
+}
+
+static MenuLayer *top_menu(void){
+  return (MenuLayer *)find_top_layer(LAYER_KIND_MENU, 0);
+}
+
+// Text of a row of the top menu, drawn for the occasion. The harness
+// peeking at a row is not counted against the app.
+static GContext menu_row_cell;
+
+static const char *menu_peek_row(int row, bool subtitle){
+  struct sim_stats saved = sim_stats;
+
+  menu_draw_cell(top_menu(), (uint16_t)row, &menu_row_cell);
+  sim_stats = saved;
+  return subtitle ? menu_row_cell.subtitle : menu_row_cell.title;
+}
+
+int sim_menu_rows(void){
+  MenuLayer *menu = top_menu();
+  return menu ? menu_rows(menu) : 0;
+}
+
+const char *sim_menu_row_title(int row){
+  return menu_peek_row(row, false);
+}
+
+const char *sim_menu_row_subtitle(int row){
+  return menu_peek_row(row, true);
+}
+
+void sim_menu_select(int row){
+  MenuLayer *menu = top_menu();
+
+  note_wakeup();
+  menu_select_row(menu, row);
+  menu_click(menu, BUTTON_ID_SELECT, false);
+  render();
+}
+
+void sim_menu_long_select(int row){
+  MenuLayer *menu = top_menu();
+
+  note_wakeup();
+  menu_select_row(menu, row);
+  menu_click(menu, BUTTON_ID_SELECT, true);
+  render();
+}
+
+const char *sim_text(int n){
+  TextLayer *text_layer = (TextLayer *)find_top_layer(LAYER_KIND_TEXT, n);
+  return text_layer ? text_layer->text : NULL;
+}
+
+static void find_drawn(Layer *layer, int x, int y, GRect *frames, int max, int *count){
+  if (layer->hidden){
+    return;
+  }
+  x += layer->frame.origin.x;
+  y += layer->frame.origin.y;
+  if (layer->kind == LAYER_KIND_PLAIN && layer->update_proc && *count < max){
+    frames[(*count)++] = GRect(x, y, layer->frame.size.w, layer->frame.size.h);
+  }
+  for (Layer *child = layer->first_child; child; child = child->next_sibling){
+    find_drawn(child, x, y, frames, max, count);
+  }
+}
+
+int sim_drawn_layers(GRect *frames, int max){
+  Window *top = window_stack_get_top_window();
+  int count = 0;
+
+  if (top){
+    find_drawn(&top->root, 0, 0, frames, max, &count);
+  }
+  return count;
+}
+
+bool sim_pixel(int x, int y){
+  return x >= 0 && y >= 0 && x < SCREEN_WIDTH && y < SCREEN_HEIGHT && framebuffer[y][x];
+}
+
+bool sim_app_running(void){
+  return !app_exited;
+}
+
+void sim_stats_reset(void){
+  memset(&sim_stats, 0, sizeof(sim_stats));
+  sim_stats.heap_peak = heap_used;
+  sim_latency_count = 0;
+  sim_inputs_pending = 0;
+}
+
+void sim_storage_reset(void){
+  memset(persist, 0, sizeof(persist));
+  wakeup_cancel_all();
+  app_worker_kill();
+}
+
+void sim_worker_slot(bool free){
+  worker_slot_free = free;
+}
+
+AppLaunchReason launch_reason(void){
+  return app_launch_reason;
+}
+
+static uint64_t ns_since_launch(void){
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)(now.tv_sec - launch_started.tv_sec) * 1000000000ULL + now.tv_nsec - launch_started.tv_nsec;
+}
+
+void app_event_loop(void){
+  sim_stats.startup_ns += ns_since_launch();
+  render();
+  sim_stats.first_frame_ns += ns_since_launch();
+  if (launch_script && !app_exited){
+    launch_script(launch_ctx);
+  }
+
+  // The loop is over: windows the app pops from here on are its teardown,
+  // not an exit.
+  launch_script = NULL;
+}
+
+static void launch(AppLaunchReason reason, void (*script)(void *ctx), void *ctx){
+  uint64_t start_ms = now_ms;
+
+  app_launch_reason = reason;
+  app_exited = false;
+  launch_script = script;
+  launch_ctx = ctx;
+  sim_stats.launches++;
+  note_wakeup();
+  clock_gettime(CLOCK_MONOTONIC, &launch_started);
+  app_up = true;
+  pebble_main();
+  app_up = false;
+  launch_script = NULL;
+  launch_ctx = NULL;
+  sim_stats.alive_ms += now_ms - start_ms;
+
+  // The system tears down whatever the app left behind.
+  reset_services();
+}
+
+void sim_launch(void (*script)(void *ctx), void *ctx){
+  launch(APP_LAUNCH_USER, script, ctx);
+}
+
+bool sim_launch_wakeup(void (*script)(void *ctx), void *ctx){
+  struct sim_wakeup *next = NULL;
+
+  for (int i = 0; i < MAX_WAKEUPS; i++){
+    if (wakeups[i].used && (!next || wakeups[i].timestamp < next->timestamp)){
+      next = &wakeups[i];
+    }
+  }
+  if (!next){
+    return false;
+  }
+
+  // The app is closed until then, nothing runs.
+  if ((uint64_t)next->timestamp * 1000 > now_ms){
+    now_ms = (uint64_t)next->timestamp * 1000;
+  }
+  launch_wakeup = *next;
+  next->used = false;
+  launch(APP_LAUNCH_WAKEUP, script, ctx);
+  return true;
+}
+
+bool sim_launch_by_worker(void (*script)(void *ctx), void *ctx){
+  uint64_t at;
+
+  // The app is closed, only the worker runs until it asks for the app.
+  while (!worker_wants_app && next_worker_event(&at)){
+    if (at > now_ms){
+      now_ms = at;
+    }
+    note_wakeup();
+    dispatch_worker_due();
+  }
+  if (!worker_wants_app){
+    return false;
+  }
+  worker_wants_app = false;
+  launch(APP_LAUNCH_WORKER, script, ctx);
+  return true;
+}
@@ -0,0 +1,6 @@
+// Host stand-in for the Pebble SDK's worker header. The worker's subset of
+// the API is declared in pebble.h with the rest; the harness tells the app's
+// calls from the worker's by who is running.
+#pragma once
+
+#include "pebble.h"
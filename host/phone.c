@@ -0,0 +1,282 @@
+// Phone stand-in: what src/sync.js does on the phone, in C, so the catalog
+// sync can be run against the app at accelerated time.
+//
+// It serves the catalog of resources/data/programs.bin, split into the
+// manifest and program blobs of src/sync.h, and encodes integers on 4 bytes
+// like PebbleKit JS does, so messages have the size they have on the phone.
+#include "sim.h"
+#include "catalog.h"
+#include "sync.h"
+
+#define PHONE_MESSAGE_MAX 2044
+
+struct phone_blob {
+  uint16_t size;
+  uint8_t data[SYNC_PROGRAM_MAX];
+};
+
+static struct {
+  uint8_t manifest[SYNC_MANIFEST_MAX];
+  uint16_t manifest_size;
+  int program_count;
+  struct phone_blob programs[SYNC_MAX_PROGRAMS];
+
+  // Stream in progress, restarted by every request.
+  bool streaming;
+  uint16_t blob;
+  uint16_t offset;
+  uint16_t chunk_size;
+  bool hello_pending;
+
+  // Faults, counted in chunks sent.
+  int cut_after;
+  int corrupt;
+} phone;
+
+struct sim_phone_stats sim_phone_stats;
+
+static uint32_t phone_crc32(const uint8_t *data, size_t size){
+  uint32_t crc = 0xFFFFFFFF;
+
+  while (size--){
+    crc ^= *data++;
+    for (int bit = 0; bit < 8; bit++){
+      crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+  }
+  return ~crc;
+}
+
+// The hashes follow the menu records in the manifest.
+static uint8_t *phone_hash_at(int program_id){
+  const struct catalog_header *header = (const struct catalog_header *)phone.manifest;
+
+  return phone.manifest + sizeof(*header) + header->menu_count * sizeof(struct catalog_menu) + program_id * sizeof(uint32_t);
+}
+
+static void phone_rehash(int program_id){
+  uint32_t hash = phone_crc32(phone.programs[program_id].data, phone.programs[program_id].size);
+
+  memcpy(phone_hash_at(program_id), &hash, sizeof(hash));
+}
+
+// Splits the packed catalog into the manifest and one blob per program.
+static void phone_load(void){
+  const char *path = SIM_RESOURCES_DIR "/data/programs.bin";
+  static uint8_t packed[16384];
+  struct catalog_header header;
+  size_t size, menus_size;
+  FILE *f = fopen(path, "rb");
+
+  if (!f){
+    fprintf(stderr, "phone: cannot open %s\n", path);
+    exit(2);
+  }
+  size = fread(packed, 1, sizeof(packed), f);
+  fclose(f);
+
+  memcpy(&header, packed, sizeof(header));
+  menus_size = header.menu_count * sizeof(struct catalog_menu);
+  phone.program_count = header.program_count < SYNC_MAX_PROGRAMS ? header.program_count : SYNC_MAX_PROGRAMS;
+  header.program_count = (uint16_t)phone.program_count;
+  phone.manifest_size = (uint16_t)(sizeof(header) + menus_size + phone.program_count * sizeof(uint32_t));
+  memcpy(phone.manifest, &header, sizeof(header));
+  memcpy(phone.manifest + sizeof(header), packed + sizeof(header), menus_size);
+
+  for (int i = 0; i < phone.program_count; i++){
+    const uint8_t *records = packed + sizeof(header) + menus_size;
+    const uint8_t *ops = records + ((const struct catalog_header *)packed)->program_count * sizeof(struct catalog_program);
+    struct catalog_program record;
+    struct phone_blob *blob = &phone.programs[i];
+
+    memcpy(&record, records + i * sizeof(record), sizeof(record));
+    if (ops + (record.first_op + record.op_count) * sizeof(uint16_t) > packed + size){
+      fprintf(stderr, "phone: %s is truncated\n", path);
+      exit(2);
+    }
+    blob->size = (uint16_t)(sizeof(record) + record.op_count * sizeof(uint16_t));
+    memcpy(blob->data + sizeof(record), ops + record.first_op * sizeof(uint16_t), record.op_count * sizeof(uint16_t));
+    record.first_op = 0;
+    memcpy(blob->data, &record, sizeof(record));
+    phone_rehash(i);
+  }
+}
+
+static uint32_t phone_manifest_hash(void){
+  return phone_crc32(phone.manifest, phone.manifest_size);
+}
+
+static uint32_t phone_tuple_uint(DictionaryIterator *iter, uint32_t key){
+  Tuple *tuple = dict_find(iter, key);
+
+  if (!tuple){
+    return 0;
+  }
+  switch (tuple->length){
+    case 1: return tuple->value->uint8;
+    case 2: return tuple->value->uint16;
+    default: return tuple->value->uint32;
+  }
+}
+
+static bool phone_send_hello(void){
+  uint8_t buffer[PHONE_MESSAGE_MAX];
+  DictionaryIterator iter;
+
+  dict_write_begin(&iter, buffer, sizeof(buffer));
+  dict_write_uint32(&iter, SYNC_KEY_OP, SYNC_OP_HELLO);
+  dict_write_uint32(&iter, SYNC_KEY_CRC, phone_manifest_hash());
+  return sim_link_send(buffer, dict_write_end(&iter));
+}
+
+// Sends the next chunk of the stream, if the link is free.
+static void phone_pump(void){
+  uint8_t buffer[PHONE_MESSAGE_MAX];
+  DictionaryIterator iter;
+  const uint8_t *data = NULL;
+  uint16_t size = 0;
+  uint16_t count;
+  uint32_t crc;
+
+  if (phone.hello_pending){
+    phone.hello_pending = !phone_send_hello();
+    return;
+  }
+  if (!phone.streaming){
+    return;
+  }
+
+  if (phone.blob == SYNC_BLOB_MANIFEST){
+    data = phone.manifest;
+    size = phone.manifest_size;
+  } else if (phone.blob < phone.program_count){
+    data = phone.programs[phone.blob].data;
+    size = phone.programs[phone.blob].size;
+  }
+  count = size > phone.offset ? size - phone.offset : 0;
+  if (count > phone.chunk_size){
+    count = phone.chunk_size;
+  }
+  crc = phone_crc32(data ? data + phone.offset : NULL, count);
+  if (phone.corrupt == (int)sim_phone_stats.chunks){
+    crc ^= 1;
+  }
+
+  dict_write_begin(&iter, buffer, sizeof(buffer));
+  dict_write_uint32(&iter, SYNC_KEY_OP, SYNC_OP_CHUNK);
+  dict_write_uint32(&iter, SYNC_KEY_BLOB, phone.blob);
+  dict_write_uint32(&iter, SYNC_KEY_OFFSET, phone.offset);
+  dict_write_uint32(&iter, SYNC_KEY_SIZE, size);
+  dict_write_uint32(&iter, SYNC_KEY_CRC, crc);
+  if (count){
+    dict_write_data(&iter, SYNC_KEY_DATA, data + phone.offset, count);
+  }
+  if (!sim_link_send(buffer, dict_write_end(&iter))){
+    return;
+  }
+
+  sim_phone_stats.chunks++;
+  sim_phone_stats.chunk_bytes += count;
+  phone.offset += count;
+  phone.streaming = phone.offset < size;
+
+  if (phone.cut_after >= 0 && (int)sim_phone_stats.chunks >= phone.cut_after){
+    sim_link_set_up(false);
+  }
+}
+
+static void phone_received(DictionaryIterator *iter){
+  if (phone_tuple_uint(iter, SYNC_KEY_OP) != SYNC_OP_REQUEST){
+    return;
+  }
+  sim_phone_stats.requests++;
+  phone.streaming = true;
+  phone.blob = (uint16_t)phone_tuple_uint(iter, SYNC_KEY_BLOB);
+  phone.offset = (uint16_t)phone_tuple_uint(iter, SYNC_KEY_OFFSET);
+  phone.chunk_size = (uint16_t)phone_tuple_uint(iter, SYNC_KEY_SIZE);
+  if (phone.chunk_size == 0){
+    phone.chunk_size = 1;
+  }
+  phone_pump();
+}
+
+// A message the app did not take ends the stream, the app asks again.
+static void phone_sent(bool delivered){
+  if (!delivered){
+    phone.streaming = false;
+    return;
+  }
+  phone_pump();
+}
+
+void sim_phone_reset(void){
+  memset(&phone, 0, sizeof(phone));
+  memset(&sim_phone_stats, 0, sizeof(sim_phone_stats));
+  phone.cut_after = -1;
+  phone.corrupt = -1;
+  phone_load();
+  sim_link_set_up(true);
+  sim_link_attach(phone_received, phone_sent);
+}
+
+// As on the JS 'ready' event, or after the catalog changed.
+void sim_phone_hello(void){
+  phone.hello_pending = true;
+  phone_pump();
+}
+
+// Adds seconds to the first segment of a program, or sets its type and
+// seconds; a type of -1 keeps it.
+static void phone_edit_segment(int program_id, int type, int seconds, bool add){
+  struct phone_blob *blob = &phone.programs[program_id];
+
+  for (size_t at = sizeof(struct catalog_program); at + sizeof(uint16_t) <= blob->size; at += sizeof(uint16_t)){
+    uint16_t op;
+
+    memcpy(&op, blob->data + at, sizeof(op));
+    if (PROGRAM_OP(op) < PROGRAM_OP_REPEAT){
+      op = (uint16_t)(((type < 0 ? PROGRAM_OP(op) : type) << PROGRAM_ARG_BITS) | PROGRAM_ARG((add ? PROGRAM_ARG(op) : 0) + seconds));
+      memcpy(blob->data + at, &op, sizeof(op));
+      break;
+    }
+  }
+  phone_rehash(program_id);
+}
+
+void sim_phone_edit_program(int program_id, int seconds){
+  phone_edit_segment(program_id, -1, seconds, true);
+}
+
+void sim_phone_set_segment(int program_id, int type, int seconds){
+  phone_edit_segment(program_id, type, seconds, false);
+}
+
+void sim_phone_grow(int program_count){
+  struct catalog_header *header = (struct catalog_header *)phone.manifest;
+  uint8_t *last_menu = phone.manifest + sizeof(*header) + (header->menu_count - 1) * sizeof(struct catalog_menu);
+  struct catalog_menu menu;
+  int longest = 0;
+
+  for (int i = 1; i < phone.program_count; i++){
+    if (phone.programs[i].size > phone.programs[longest].size){
+      longest = i;
+    }
+  }
+
+  memcpy(&menu, last_menu, sizeof(menu));
+  while (phone.program_count < program_count && phone.program_count < SYNC_MAX_PROGRAMS){
+    phone.programs[phone.program_count] = phone.programs[longest];
+    phone_rehash(phone.program_count);
+    phone.program_count++;
+    header->program_count++;
+    menu.program_count++;
+  }
+  memcpy(last_menu, &menu, sizeof(menu));
+  phone.manifest_size = (uint16_t)(sizeof(*header) + header->menu_count * sizeof(struct catalog_menu) + phone.program_count * sizeof(uint32_t));
+}
+
+void sim_phone_faults(int cut_after_chunks, int corrupt_chunk){
+  phone.cut_after = cut_after_chunks;
+  phone.corrupt = corrupt_chunk;
+  sim_link_set_up(true);
+}
@@ -0,0 +1,231 @@
+// Harness side of the host stand-in: virtual clock control, scripted input
+// and the counters collected while the app runs.
+#pragma once
+
+#define SIM_HARNESS
+#include "pebble.h"
+
+// Counters collected between two calls to sim_stats_reset().
+struct sim_stats {
+  // Distinct instants at which the CPU was woken up (ticks, timers,
+  // accelerometer batches, input).
+  uint32_t wakeups;
+
+  // Tick handler invocations.
+  uint32_t ticks;
+
+  // App timer callbacks fired.
+  uint32_t timers;
+
+  // Calls that (re)register a time source with the OS: tick service
+  // subscribe/unsubscribe and app_timer_register/reschedule/cancel.
+  uint32_t timer_calls;
+
+  // Render passes, i.e. wakeups that left at least one layer dirty.
+  uint32_t frames;
+
+  // Layer invalidations (explicit and implied by text_layer_set_text).
+  uint32_t invalidations;
+
+  // Pixels covered by the dirty layers of every frame.
+  uint64_t redraw_area;
+
+  // Visible layers left clean by a frame, i.e. the invalidations a redraw
+  // of the whole window would have cost, and the pixels they cover.
+  uint32_t skipped_layers;
+  uint64_t skipped_area;
+
+  // Black pixels custom layers filled.
+  uint64_t filled_area;
+
+  // APP_LOG calls.
+  uint32_t logs;
+
+  // Most of the app heap in use at once, in bytes at the host's struct
+  // sizes, starting from what was in use at the reset.
+  uint32_t heap_peak;
+
+  // Bytes read from resources.
+  uint32_t resource_bytes;
+
+  // Menu rows drawn through the app's draw_row callback.
+  uint32_t cells_drawn;
+
+  // Windows loaded and layers created.
+  uint32_t windows_loaded;
+  uint32_t layers_created;
+
+  // Host time from launch to the event loop, i.e. the app's startup, and
+  // to the end of the first frame.
+  uint64_t startup_ns;
+  uint64_t first_frame_ns;
+
+  // App launches and the time the app spent running.
+  uint32_t launches;
+  uint64_t alive_ms;
+
+  // persist_read_data calls, persist_write_data calls and the bytes they
+  // wrote.
+  uint32_t persist_reads;
+  uint32_t persist_writes;
+  uint32_t persist_bytes;
+
+  // AppMessages the app sent and received, and the size of the latter.
+  uint32_t messages_sent;
+  uint32_t messages_received;
+  uint32_t message_bytes;
+
+  // Accelerometer batches handed to the app, and the samples in them.
+  uint32_t accel_batches;
+  uint32_t accel_samples;
+
+  // Taps handed to the app.
+  uint32_t accel_taps;
+
+  // Vibrations, by pattern, and the ones cut short by vibes_cancel.
+  uint32_t vibes_short;
+  uint32_t vibes_long;
+  uint32_t vibes_double;
+  uint32_t vibes_custom;
+  uint32_t vibes_cancelled;
+
+  // Milliseconds the vibration motor was on.
+  uint32_t vibe_ms;
+
+  // AppWorkerMessages either way, and the worker's timer callbacks.
+  uint32_t worker_messages;
+  uint32_t worker_timers;
+};
+
+extern struct sim_stats sim_stats;
+
+// Input latency: every sim_click and sim_long_click waits for the next
+// frame, which answers it. The virtual time in between, and the host time
+// from the press to the end of the frame. Kept from the last
+// sim_stats_reset, up to SIM_MAX_LATENCIES; presses no frame answered yet
+// are sim_inputs_pending.
+#define SIM_MAX_LATENCIES 256
+
+struct sim_latency {
+  uint32_t ms;
+  uint64_t ns;
+};
+
+extern struct sim_latency sim_latencies[SIM_MAX_LATENCIES];
+extern int sim_latency_count;
+extern int sim_inputs_pending;
+
+// Entry points of the app under test and of its worker (their main()
+// renamed by the build).
+int pebble_main(void);
+int pebble_worker_main(void);
+
+// Launches the app. The script runs inside app_event_loop() and drives the
+// app through the functions below; the app exits when it returns, as if
+// the system closed it, or once its window stack is empty.
+void sim_launch(void (*script)(void *ctx), void *ctx);
+
+// Moves the clock to the earliest wakeup the app scheduled and launches it
+// for that wakeup. Returns false, launching nothing, if none is pending.
+bool sim_launch_wakeup(void (*script)(void *ctx), void *ctx);
+
+// Runs the worker alone until it launches the app, and launches it for the
+// worker. Returns false, launching nothing, if the worker is not running or
+// has nothing left to do.
+bool sim_launch_by_worker(void (*script)(void *ctx), void *ctx);
+
+// Frees the watch's one worker slot for the app, or gives it to another
+// app, as it is until then: app_worker_launch() then asks the user, who is
+// taken to decline.
+void sim_worker_slot(bool free);
+
+// False once the app emptied its window stack.
+bool sim_app_running(void);
+
+// Wipes persistent storage and pending wakeups and kills the worker, as a
+// reinstall would.
+void sim_storage_reset(void);
+
+// Bytes the app holds in persistent storage, out of the 4 KB it gets.
+uint32_t sim_persist_used(void);
+
+// Phone end of the AppMessage link. What the app sends is handed to the
+// received callback; sim_link_send() puts a message on its way to the app
+// and the sent callback tells whether it got in. Returns false while the
+// previous message is in flight.
+typedef void (*SimPhoneReceived)(DictionaryIterator *iter);
+typedef void (*SimPhoneSent)(bool delivered);
+
+void sim_link_attach(SimPhoneReceived received, SimPhoneSent sent);
+bool sim_link_send(const uint8_t *data, size_t size);
+void sim_link_set_up(bool up);
+
+// Phone stand-in (phone.c), the host's src/sync.js: it serves the catalog
+// of resources/data/programs.bin. A program can be edited there, its first
+// segment made longer, or set to any opcode and length, 0 included, as a
+// bad edit would; a type of -1 keeps its own. The catalog can grow, to
+// program_count, with copies of its longest program in its last menu.
+// Faults cut the link after a number of chunks, or send one chunk with a
+// bad CRC; -1 for none.
+struct sim_phone_stats {
+  uint32_t requests;
+  uint32_t chunks;
+  uint32_t chunk_bytes;
+};
+
+extern struct sim_phone_stats sim_phone_stats;
+
+void sim_phone_reset(void);
+void sim_phone_hello(void);
+void sim_phone_edit_program(int program_id, int seconds);
+void sim_phone_set_segment(int program_id, int type, int seconds);
+void sim_phone_grow(int program_count);
+void sim_phone_faults(int cut_after_chunks, int corrupt_chunk);
+
+// Wrist the accelerometer is on: x, y, z in mg taken at rate_hz, played in
+// a loop from now at whatever rate the app samples. NULL for a still wrist.
+void sim_accel_play(const int16_t (*xyz)[3], uint32_t count, uint32_t rate_hz);
+
+// A tap on the watch, if the app listens for one.
+void sim_accel_tap(AccelAxisType axis, int32_t direction);
+
+// Battery charge in percent, and whether the watch is plugged in and
+// charging. Kept across launches; the app is told if it listens.
+void sim_battery_set(uint8_t percent, bool charging);
+
+// Virtual clock in milliseconds.
+uint64_t sim_now_ms(void);
+
+// Advances the clock by ms, dispatching every tick and timer that falls due.
+void sim_run_for(uint64_t ms);
+
+// Runs until the app has no tick, accelerometer or timer left, or exits, or
+// until cap_ms have elapsed. Returns true if the app went idle before the
+// cap.
+bool sim_run_until_idle(uint64_t cap_ms);
+
+// Input on the top window.
+void sim_click(ButtonId button);
+void sim_long_click(ButtonId button);
+
+// Menu on the top window.
+int sim_menu_rows(void);
+const char *sim_menu_row_title(int row);
+const char *sim_menu_row_subtitle(int row);
+void sim_menu_select(int row);
+void sim_menu_long_select(int row);
+
+// Text currently shown by the n-th text layer of the top window.
+const char *sim_text(int n);
+
+// Screen frames of the visible custom-drawn layers of the top window, in
+// tree order, at most max of them. Returns how many there are.
+int sim_drawn_layers(GRect *frames, int max);
+
+// Whether the pixel at x, y of the screen was last painted black.
+bool sim_pixel(int x, int y);
+
+void sim_stats_reset(void);
+
+// Echo APP_LOG output to stderr.
+extern bool sim_verbose;
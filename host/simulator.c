@@ -0,0 +1,2232 @@
+// Host benchmark of the interval engine.
+//
+// Launches the app once per workout, picks it through the menus like a user
+// would, and runs it at accelerated time until it goes idle. One line per
+// workout reports what the watch would have spent on it. A second table
+// runs every workout again with the app closed right after the start, so
+// that only the boundary wakeups bring it back.
+//
+// Usage: rc_sim [-v] [-c cap_minutes] [-e name=cost,...]
+#include <dirent.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "energy.h"
+#include "cadence.h"
+#include "motion.h"
+#include "control_block.h"
+#include "ram.h"
+#include "digits.h"
+#include "catalog.h"
+#include "sync.h"
+#include "history.h"
+#include "resources.h"
+
+#define LABEL_SIZE 32
+
+// Delay between launching the app and picking a workout.
+#define REACTION_MS 400
+
+// Drift check: pause this often, for this long, mid-second on purpose. The
+// workout must end as long after a straight run as it was paused, to the ms.
+#define DRIFT_MENU "F210K"
+#define DRIFT_PROGRAM "Week 6"
+#define DRIFT_PAUSE_EVERY_MS (5 * 60 * 1000 + 333)
+#define DRIFT_PAUSE_MS 1700
+
+// Resume check: run this workout for a while, close the app, reopen it a
+// bit later and compare with a straight run.
+#define RESUME_MENU "F210K"
+#define RESUME_PROGRAM "Week 3"
+#define RESUME_RUN_MS (10 * 60 * 1000 + 250)
+#define RESUME_CLOSED_MS (3 * 60 * 1000 + 500)
+
+// Power mode only refreshes the minutes on minute ticks, compare the two
+// runs once both had one.
+#define RESUME_SETTLE_MS (60 * 1000)
+
+// Time-to-resume budget: what a relaunch with a live session may cost
+// before its first frame.
+#define RESUME_BUDGET_WINDOWS 1
+#define RESUME_BUDGET_RESOURCE_BYTES 256
+#define RESUME_BUDGET_PERSIST_READS 1
+
+// Cold starts timed, the fastest is reported: one launch is too short for
+// the host's clock to be steady.
+#define COLD_START_RUNS 100
+
+#define TEXT_SIZE 32
+
+// What the timer window shows: the time, read back from its digits, then
+// its three text layers.
+#define TIMER_TEXTS 4
+#define TIMER_DRAWN_LAYERS (DIGITS_COUNT + 1)
+
+// Scrub check: every second of every program is looked up by binary search
+// and compared with a walk through its intervals, endless ones for this
+// long. Then the resume workout is scrubbed forward and back with long
+// presses to where a straight run gets in RESUME_RUN_MS.
+#define SCRUB_FOREVER_S (3 * 60 * 60)
+#define SCRUB_PRESSES_FORWARD 12
+#define SCRUB_PRESSES_BACK 2
+
+// Sync check: the phone's catalog goes to a fresh install, where every menu
+// must read back, then an edit of the first program, then again to a fresh
+// install with the link cut after this many chunks and one chunk corrupted.
+// Resuming may only cost the manifest again and the chunks that were lost.
+#define SYNC_CAP_MS (5 * 60 * 1000)
+#define SYNC_EDIT_SECONDS 60
+#define SYNC_CUT_AFTER_CHUNKS 20
+#define SYNC_CORRUPT_CHUNK 5
+#define SYNC_RESUME_EXTRA_CHUNKS 4
+
+// Sync budget check: the phone's catalog grown to as many programs as a
+// manifest may list, which even at one op each would not fit in the
+// storage the watch leaves it, then to fewer, which only do not fit once
+// they come in. Both must be refused, the first from its manifest alone,
+// the second before it takes more than the budget, and neither asked for
+// again on the next hello while the app runs.
+#define SYNC_GROWN_PROGRAMS 56
+
+// Re-sync check: a catalog is synced, this many of its programs edited on
+// the phone, and the re-sync cut once the first of them came in. The menus
+// must then show one catalog throughout, the one synced before (the
+// resource's, as the phone starts from it) or the new one, and the re-sync
+// must complete on the next hello with what is left.
+#define SYNC_RESYNC_EDITS 3
+
+// Resume after sync check: the resume workout is closed, a sync that edits
+// another program lands, and reopened it must carry on; then one that
+// edits its own program, and reopened it must be gone, not resumed into
+// intervals it was not started with.
+#define RESUME_SYNC_OTHER_PROGRAM 0
+
+// Malformed check: a catalog synced with a bad first segment in a program
+// that repeats forever, which the packer would have refused: one of no
+// seconds, whose boundaries would all be posted at the same instant, one
+// longer than the timer shows, and one of an opcode no interval type has.
+// The watch must drop the program and keep the menu up.
+#define MALFORMED_MENU "Intervals"
+#define MALFORMED_PROGRAM "1 min"
+#define MALFORMED_OPCODE 7
+
+// Menu check: what opening a menu may cost, whatever its length. Four rows
+// fit on the screen.
+#define MENU_BUDGET_CELLS 4
+#define MENU_BUDGET_RESOURCE_BYTES 256
+
+// History check: this many workouts in a row from the first menu, every
+// other one stopped with back after a while and a couple of skips.
+#define HISTORY_CHECK_WORKOUTS 20
+#define HISTORY_ABANDON_AFTER_MS (2 * 60 * 1000)
+
+// Cadence check: every trace of SIM_TRACES_DIR through the step detector,
+// which must be within this many percent or steps per minute of the
+// reference, whichever is more, then timed over this many passes. Then a
+// workout runs with the first running trace on the wrist and must show
+// that cadence once paused in its first run interval.
+#ifndef SIM_TRACES_DIR
+#define SIM_TRACES_DIR "host/traces"
+#endif
+#define CADENCE_MAX_TRACES 16
+#define CADENCE_TOLERANCE_PERCENT 8
+#define CADENCE_TOLERANCE_SPM 8
+#define CADENCE_BENCH_PASSES 20
+#define CADENCE_RUN_MS (9 * 60 * 1000)
+
+// Auto-pause check: the resume workout runs with every trace that has still
+// stretches on the wrist, for the trace's length. Each stretch must pause it
+// once, within MOTION_STOP_MS and two batches of its start, and resume it
+// within a resting batch and a second of its end; nothing else may pause
+// it. Then a tap must resume at once, a pause with select must outlast the
+// wearer moving, and a periodic timer must never pause.
+#define AUTO_PAUSE_MAX_STOPS 8
+#define AUTO_PAUSE_STEP_MS 100
+#define AUTO_PAUSE_LAG_MS (MOTION_STOP_MS + 2000)
+#define AUTO_RESUME_LAG_MS (MOTION_REST_BATCH * 1000 / MOTION_REST_SAMPLING_HZ + 1000)
+#define AUTO_PAUSE_MANUAL_AT_MS (30 * 1000)
+#define AUTO_PAUSE_MANUAL_MS (20 * 1000)
+#define AUTO_PAUSE_PERIODIC_MENU "Intervals"
+#define AUTO_PAUSE_PERIODIC_PROGRAM "1 min"
+
+// Replay check: every button trace of SIM_TRACES_DIR (.keys files, one
+// press per line: ms from the start of the workout, button, "long") is
+// played on the resume workout. Every press must be answered by a frame
+// within the budget, then the replay runs on for a while to catch what the
+// presses left behind.
+#define REPLAY_MAX_TRACES 8
+#define REPLAY_MAX_PRESSES 64
+#define REPLAY_AFTER_MS (10 * 1000)
+#define REPLAY_BUDGET_MS 50
+
+// RAM check: the most heap in use on each screen on the way to the resume
+// workout, within a budget. The app's own notes must have seen most of it,
+// all but the short lived objects between them. The host's structs are
+// bigger than the firmware's, so this bounds growth rather than giving the
+// watch's own figure.
+#define RAM_TIMER_RUN_MS (2 * 60 * 1000)
+#define RAM_BUDGET_HEAP_BYTES 2048
+
+// Render check: a workout that shows seconds throughout, what a frame
+// repaints and fills and what it costs the host. Each frame must repaint
+// less than the 144 by 44 text layer the time used to be.
+#define RENDER_MENU "Intervals"
+#define RENDER_PROGRAM "1 min"
+#define RENDER_RUN_MS (10 * 60 * 1000)
+#define RENDER_TEXT_LAYER_AREA (144 * 44)
+
+// Reminders check: the hour long F210K run as is, then with two periodic
+// programs on as reminders. They go off on the minute redraws of power
+// mode, so they may not add a timer callback, and each second with a
+// reminder may add one vibration, none when a boundary or a warning buzzes
+// then. Then both in the background, where each such second relaunches
+// the app.
+#define REMINDERS_MENU "F210K"
+#define REMINDERS_PROGRAM "Week 6"
+#define REMINDERS_PERIODIC_MENU "Intervals"
+#define REMINDERS_PERIODIC_A "5 min"
+#define REMINDERS_PERIODIC_B "10 min"
+
+// Low power check: every workout of the first table again with the
+// battery at half the charge that switches the app to low power mode,
+// against the energy noted for it. Each must buzz the same boundaries,
+// count no steps and draw less. Then F210K Week 6 must say so on the period
+// line, with the time hidden, and plugged in after a while, count down its
+// seconds again.
+#define LOW_POWER_BATTERY (LOW_POWER_PERCENT / 2)
+#define LOW_POWER_MENU "F210K"
+#define LOW_POWER_PROGRAM "Week 6"
+#define LOW_POWER_PLUG_MS (10 * 60 * 1000)
+#define LOW_POWER_PROBE_MS (60 * 1000)
+
+struct workout {
+  int menu_row;
+  int program_row;
+
+  // Filled in by the scripts.
+  char menu_title[LABEL_SIZE];
+  char title[LABEL_SIZE];
+  int program_rows;
+  bool finished;
+  uint64_t elapsed_ms;
+};
+
+static uint64_t cap_ms = 120 * 60 * 1000;
+
+// Launches the app on a clean install, so no session carries over.
+static void launch_fresh(void (*script)(void *ctx), void *ctx){
+  sim_storage_reset();
+  sim_launch(script, ctx);
+}
+
+// Records the size of the main menu.
+static void count_script(void *ctx){
+  *(int *)ctx = sim_menu_rows();
+}
+
+// Opens a program menu and records its size.
+static void enumerate_script(void *ctx){
+  struct workout *w = ctx;
+
+  snprintf(w->menu_title, sizeof(w->menu_title), "%s", sim_menu_row_title(w->menu_row));
+  sim_menu_select(w->menu_row);
+  w->program_rows = sim_menu_rows();
+}
+
+// Runs one workout from the menus to the end.
+static void workout_script(void *ctx){
+  struct workout *w = ctx;
+  uint64_t started;
+
+  sim_run_for(REACTION_MS);
+  sim_menu_select(w->menu_row);
+  snprintf(w->title, sizeof(w->title), "%.10s %.20s", sim_menu_row_title(w->program_row), sim_menu_row_subtitle(w->program_row));
+
+  sim_stats_reset();
+  started = sim_now_ms();
+  sim_menu_select(w->program_row);
+  w->finished = sim_run_until_idle(cap_ms);
+  w->elapsed_ms = sim_now_ms() - started;
+}
+
+// Starts a workout and lets the system close the app right away.
+static void background_start_script(void *ctx){
+  struct workout *w = ctx;
+
+  sim_run_for(REACTION_MS);
+  sim_menu_select(w->menu_row);
+  snprintf(w->title, sizeof(w->title), "%.10s %.20s", sim_menu_row_title(w->program_row), sim_menu_row_subtitle(w->program_row));
+
+  sim_stats_reset();
+  w->elapsed_ms = sim_now_ms();
+  sim_menu_select(w->program_row);
+}
+
+// Relaunched by a boundary wakeup: runs until the app closes itself.
+static void background_wakeup_script(void *ctx){
+  sim_run_until_idle(cap_ms);
+}
+
+// Launches the closed app for its next alert, by wakeup or by the worker.
+static bool relaunch(bool by_worker){
+  return by_worker ? sim_launch_by_worker(background_wakeup_script, NULL) :
+                     sim_launch_wakeup(background_wakeup_script, NULL);
+}
+
+// Runs one workout in the background, from wakeup to wakeup, or with the
+// worker slot free, from one launch by the worker to the next.
+static void run_background(struct workout *w, bool by_worker){
+  uint64_t started;
+
+  sim_worker_slot(by_worker);
+  launch_fresh(background_start_script, w);
+  started = w->elapsed_ms;
+
+  w->finished = true;
+  while (relaunch(by_worker)){
+    if (sim_now_ms() - started >= cap_ms){
+      w->finished = false;
+      break;
+    }
+  }
+  w->elapsed_ms = sim_now_ms() - started;
+  sim_worker_slot(false);
+}
+
+// Opens a program menu and scrolls to its last row, recording what each
+// step cost.
+struct menu_probe {
+  int menu_row;
+  int rows;
+  struct sim_stats open;
+  struct sim_stats scroll;
+};
+
+static void menu_probe_script(void *ctx){
+  struct menu_probe *m = ctx;
+
+  sim_stats_reset();
+  sim_menu_select(m->menu_row);
+  m->open = sim_stats;
+  m->rows = sim_menu_rows();
+
+  sim_stats_reset();
+  for (int row = 1; row < m->rows; row++){
+    sim_click(BUTTON_ID_DOWN);
+  }
+  m->scroll = sim_stats;
+}
+
+static void print_menus(int main_rows){
+  bool within = true;
+
+  printf("\n");
+  for (int row = 0; row < main_rows; row++){
+    struct menu_probe m = { .menu_row = row };
+    int clicks;
+
+    launch_fresh(menu_probe_script, &m);
+    clicks = m.rows > 1 ? m.rows - 1 : 1;
+    within = within && m.open.cells_drawn <= MENU_BUDGET_CELLS &&
+             m.open.resource_bytes <= MENU_BUDGET_RESOURCE_BYTES;
+    printf("menu %d: %d rows, opened with %u cells and %u resource bytes, %.1f cells and %.0f bytes per row scrolled\n",
+           row, m.rows, m.open.cells_drawn, m.open.resource_bytes,
+           (double)m.scroll.cells_drawn / clicks, (double)m.scroll.resource_bytes / clicks);
+  }
+  printf("menus: %s\n", within ? "within budget" : "OVER BUDGET");
+
+  if (!within){
+    exit(1);
+  }
+}
+
+// Says hello from the phone and lets the sync run its course.
+struct sync_run {
+  uint64_t elapsed_ms;
+  struct sim_phone_stats phone;
+  struct sim_stats watch;
+};
+
+static void sync_script(void *ctx){
+  struct sync_run *r = ctx;
+  uint64_t started = sim_now_ms();
+
+  sim_stats_reset();
+  sim_phone_stats = (struct sim_phone_stats){ 0 };
+  sim_phone_hello();
+  sim_run_until_idle(SYNC_CAP_MS);
+  r->elapsed_ms = sim_now_ms() - started;
+  r->phone = sim_phone_stats;
+  r->watch = sim_stats;
+}
+
+static void print_sync_run(const char *what, const struct sync_run *r){
+  printf("sync %-9s %2u requests, %3u chunks, %5u bytes of data in %5.2f s (%4.0f B/s), %4u bytes received\n",
+         what, r->phone.requests, r->phone.chunks, r->phone.chunk_bytes, r->elapsed_ms / 1000.0,
+         r->elapsed_ms ? r->phone.chunk_bytes * 1000.0 / r->elapsed_ms : 0.0, r->watch.message_bytes);
+}
+
+// Syncs a catalog grown to program_count to a fresh install, and the phone
+// says hello again.
+struct sync_budget_run {
+  struct sync_run first;
+  struct sync_run again;
+  uint32_t stored;
+  bool catalog;
+};
+
+static void sync_budget_script(void *ctx){
+  struct sync_budget_run *r = ctx;
+
+  sync_script(&r->first);
+  r->stored = sim_persist_used();
+  r->catalog = sync_catalog_stored();
+  sync_script(&r->again);
+}
+
+static void run_sync_budget(int program_count, struct sync_budget_run *r){
+  sim_storage_reset();
+  sim_phone_reset();
+  sim_phone_grow(program_count);
+  sim_launch(sync_budget_script, r);
+  sim_storage_reset();
+  sim_phone_reset();
+}
+
+static void print_sync_budget(void){
+  struct sync_budget_run full = { .catalog = false };
+  struct sync_budget_run grown = { .catalog = false };
+  bool ok;
+
+  run_sync_budget(SYNC_MAX_PROGRAMS, &full);
+  run_sync_budget(SYNC_GROWN_PROGRAMS, &grown);
+
+  printf("sync: %d programs refused after %u requests, %d after %u requests and %u bytes stored, budget %d bytes\n",
+         SYNC_MAX_PROGRAMS, full.first.phone.requests, SYNC_GROWN_PROGRAMS, grown.first.phone.requests,
+         grown.stored, (int)SYNC_STORED_BUDGET);
+
+  ok = full.first.phone.requests == 1 && !full.catalog && full.again.phone.requests == 0 &&
+       grown.first.phone.requests > 1 && !grown.catalog && grown.again.phone.requests == 0 &&
+       grown.stored <= SYNC_STORED_BUDGET;
+  printf("sync: %s\n", ok ? "catalogs over the storage budget refused and not asked for again" :
+                            "A CATALOG OVER BUDGET WAS STORED OR ASKED FOR AGAIN");
+  if (!ok){
+    exit(1);
+  }
+}
+
+// Hashes of the programs the catalog shows, menu by menu, as the app reads
+// them; 0 for one that does not load. Returns how many.
+static int catalog_hashes(uint32_t *hashes){
+  static struct program code;
+  struct catalog_menu menu;
+  struct catalog_program record;
+  int count = 0;
+
+  catalog_init();
+  for (int m = 0; m < catalog_menu_count() && catalog_load_menu(m, &menu); m++){
+    for (int p = 0; p < menu.program_count && count < SYNC_MAX_PROGRAMS; p++){
+      int id = menu.first_program + p;
+
+      hashes[count++] = catalog_load_program_record(id, &record) && catalog_load_program(id, &record, &code) ?
+                        catalog_program_hash(&record, &code) : 0;
+    }
+  }
+  return count;
+}
+
+static void print_resync(void){
+  static uint32_t before[SYNC_MAX_PROGRAMS], cut[SYNC_MAX_PROGRAMS], after[SYNC_MAX_PROGRAMS];
+  struct sync_run first = { 0 }, one = { 0 }, partial = { 0 }, resumed = { 0 };
+  int count_before, count_cut, count_after;
+  bool old_catalog, new_catalog;
+  bool ok;
+
+  // A re-sync of one program, to cut the next one right after it: the
+  // chunk that goes out as the link drops is lost.
+  sim_storage_reset();
+  sim_phone_reset();
+  sim_launch(sync_script, &first);
+  sim_phone_edit_program(0, SYNC_EDIT_SECONDS);
+  sim_launch(sync_script, &one);
+
+  sim_storage_reset();
+  sim_phone_reset();
+  sim_launch(sync_script, &first);
+  count_before = catalog_hashes(before);
+  for (int i = 0; i < SYNC_RESYNC_EDITS; i++){
+    sim_phone_edit_program(i, SYNC_EDIT_SECONDS);
+  }
+  sim_phone_faults(one.phone.chunks + 1, -1);
+  sim_launch(sync_script, &partial);
+  sim_phone_faults(-1, -1);
+  count_cut = catalog_hashes(cut);
+  sim_launch(sync_script, &resumed);
+  count_after = catalog_hashes(after);
+  sim_storage_reset();
+  sim_phone_reset();
+  catalog_init();
+
+  old_catalog = count_cut == count_before;
+  new_catalog = count_cut == count_after;
+  for (int i = 0; i < count_cut; i++){
+    old_catalog = old_catalog && cut[i] == before[i] && cut[i] != 0;
+    new_catalog = new_catalog && cut[i] == after[i] && cut[i] != 0;
+  }
+
+  printf("resync: %d programs edited, cut after %u chunks shows %d programs from %s, resumed with %u requests\n",
+         SYNC_RESYNC_EDITS, partial.phone.chunks, count_cut,
+         old_catalog ? "the catalog before" : new_catalog ? "the new catalog" : "BOTH CATALOGS",
+         resumed.phone.requests);
+
+  ok = count_cut > 0 && (old_catalog || new_catalog) && partial.phone.chunks == one.phone.chunks + 1 &&
+       count_after == count_before && resumed.phone.requests == SYNC_RESYNC_EDITS &&
+       after[0] != before[0] && after[SYNC_RESYNC_EDITS - 1] != before[SYNC_RESYNC_EDITS - 1];
+  if (!ok){
+    exit(1);
+  }
+}
+
+static void print_sync(void){
+  struct sync_run full = { 0 }, same = { 0 }, edit = { 0 }, cut = { 0 }, resumed = { 0 }, after = { 0 };
+  struct workout before = { .menu_row = 0, .program_row = 0 };
+  struct workout edited = { .menu_row = 0, .program_row = 0 };
+  uint32_t resumed_chunks;
+  uint32_t stored;
+  int menus = 0;
+  int menus_read = 0;
+  bool ok;
+
+  printf("\n");
+  launch_fresh(workout_script, &before);
+
+  sim_phone_reset();
+  sim_launch(sync_script, &full);
+  stored = sim_persist_used();
+  sim_launch(sync_script, &same);
+
+  // Every menu of the stored manifest reads back.
+  catalog_init();
+  for (menus = 0; menus < catalog_menu_count(); menus++){
+    struct catalog_menu menu;
+
+    menus_read += catalog_load_menu(menus, &menu);
+  }
+
+  sim_phone_edit_program(0, SYNC_EDIT_SECONDS);
+  sim_launch(sync_script, &edit);
+  sim_launch(workout_script, &edited);
+
+  sim_storage_reset();
+  sim_phone_reset();
+  sim_phone_faults(SYNC_CUT_AFTER_CHUNKS, SYNC_CORRUPT_CHUNK);
+  sim_launch(sync_script, &cut);
+  sim_phone_faults(-1, -1);
+  sim_launch(sync_script, &resumed);
+  sim_launch(sync_script, &after);
+  resumed_chunks = cut.phone.chunks + resumed.phone.chunks;
+
+  print_sync_run("full", &full);
+  print_sync_run("same", &same);
+  print_sync_run("edit", &edit);
+  print_sync_run("cut", &cut);
+  print_sync_run("resumed", &resumed);
+
+  ok = same.phone.requests == 0 && edit.phone.requests == 2 && after.phone.requests == 0 &&
+       edited.elapsed_ms == before.elapsed_ms + SYNC_EDIT_SECONDS * 1000 &&
+       menus_read == menus && menus > 0 &&
+       resumed_chunks <= full.phone.chunks + SYNC_RESUME_EXTRA_CHUNKS;
+  printf("sync: %u bytes stored, edited program runs %+lld s, cut transfer took %u chunks against %u, %s\n",
+         stored, (long long)(edited.elapsed_ms - before.elapsed_ms) / 1000, resumed_chunks, full.phone.chunks,
+         ok ? "consistent" : "INCONSISTENT");
+
+  if (!ok){
+    exit(1);
+  }
+}
+
+// Row of the top menu with the given title, or -1.
+static int find_row(const char *title){
+  for (int row = 0; row < sim_menu_rows(); row++){
+    if (strcmp(sim_menu_row_title(row), title) == 0){
+      return row;
+    }
+  }
+  return -1;
+}
+
+// Reads the painted digits of the top window back from the screen, the
+// colon being the one custom layer narrower than a digit.
+static void read_digits(char *text, size_t size){
+  GRect frames[TIMER_DRAWN_LAYERS];
+  int count = sim_drawn_layers(frames, TIMER_DRAWN_LAYERS);
+  size_t length = 0;
+
+  for (int i = 0; i < count && length + 1 < size; i++){
+    uint8_t segments = 0;
+    char c = '?';
+
+    if (frames[i].size.w != DIGIT_WIDTH){
+      text[length++] = ':';
+      continue;
+    }
+    for (int n = 0; n < 7; n++){
+      GRect r = digit_segment_rects[n];
+
+      if (sim_pixel(frames[i].origin.x + r.origin.x + r.size.w / 2, frames[i].origin.y + r.origin.y + r.size.h / 2)){
+        segments |= 1 << n;
+      }
+    }
+    for (int d = 0; d < 10; d++){
+      if (digit_segments[d] == segments){
+        c = '0' + d;
+      }
+    }
+    text[length++] = c;
+  }
+  text[length] = '\0';
+}
+
+// The n-th line of the timer window, as in TIMER_TEXTS.
+static void timer_text(int n, char *text, size_t size){
+  if (n == 0){
+    read_digits(text, size);
+  } else {
+    snprintf(text, size, "%s", sim_text(n - 1) ? sim_text(n - 1) : "");
+  }
+}
+
+// Runs the drift workout, optionally pausing it at odd instants. Reports the
+// time from start to end and the time spent paused.
+struct drift_run {
+  bool pause;
+  bool found;
+  uint64_t elapsed_ms;
+  uint64_t paused_ms;
+};
+
+static void drift_script(void *ctx){
+  struct drift_run *d = ctx;
+  uint64_t started;
+  int row;
+
+  sim_run_for(REACTION_MS);
+  if ((row = find_row(DRIFT_MENU)) < 0){
+    return;
+  }
+  sim_menu_select(row);
+  if ((row = find_row(DRIFT_PROGRAM)) < 0){
+    return;
+  }
+  d->found = true;
+
+  started = sim_now_ms();
+  sim_menu_select(row);
+  if (d->pause){
+    while (!sim_run_until_idle(DRIFT_PAUSE_EVERY_MS)){
+      sim_click(BUTTON_ID_SELECT);
+      sim_run_for(DRIFT_PAUSE_MS);
+      d->paused_ms += DRIFT_PAUSE_MS;
+      sim_click(BUTTON_ID_SELECT);
+    }
+  } else {
+    sim_run_until_idle(cap_ms);
+  }
+  d->elapsed_ms = sim_now_ms() - started;
+}
+
+// Starts the resume workout and runs it for ms, then records the timer
+// window.
+struct resume_run {
+  uint64_t run_ms;
+  bool found;
+  bool timer;
+  char texts[TIMER_TEXTS][TEXT_SIZE];
+  struct sim_stats startup;
+};
+
+static void record_texts(struct resume_run *r){
+  r->timer = sim_menu_rows() == 0;
+  for (int i = 0; i < TIMER_TEXTS; i++){
+    timer_text(i, r->texts[i], TEXT_SIZE);
+  }
+}
+
+static void resume_start_script(void *ctx){
+  struct resume_run *r = ctx;
+  int row;
+
+  sim_run_for(REACTION_MS);
+  if ((row = find_row(RESUME_MENU)) < 0){
+    return;
+  }
+  sim_menu_select(row);
+  if ((row = find_row(RESUME_PROGRAM)) < 0){
+    return;
+  }
+  r->found = true;
+  sim_menu_select(row);
+  sim_run_for(r->run_ms);
+  record_texts(r);
+}
+
+// Relaunched by the user: records what startup cost and what is shown.
+static void resume_probe_script(void *ctx){
+  struct resume_run *r = ctx;
+
+  r->startup = sim_stats;
+  sim_run_for(r->run_ms);
+  record_texts(r);
+}
+
+static void print_resume(void){
+  struct resume_run straight = { .run_ms = RESUME_RUN_MS + RESUME_CLOSED_MS + RESUME_SETTLE_MS };
+  struct resume_run resumed = { .run_ms = RESUME_RUN_MS };
+  struct resume_run cold = { 0 };
+  const struct sim_stats *s = &resumed.startup;
+  bool same = true;
+  bool within;
+
+  launch_fresh(resume_start_script, &straight);
+  launch_fresh(resume_start_script, &resumed);
+  if (!straight.found || !resumed.found){
+    return;
+  }
+
+  // The app is closed, then reopened by the user.
+  sim_run_for(RESUME_CLOSED_MS);
+  sim_stats_reset();
+  resumed.run_ms = RESUME_SETTLE_MS;
+  sim_launch(resume_probe_script, &resumed);
+
+  for (int i = 0; i < TIMER_TEXTS; i++){
+    same = same && strcmp(straight.texts[i], resumed.texts[i]) == 0;
+  }
+
+  for (int i = 0; i < COLD_START_RUNS; i++){
+    struct resume_run run = { 0 };
+
+    sim_storage_reset();
+    sim_stats_reset();
+    sim_launch(resume_probe_script, &run);
+    if (i == 0 || run.startup.first_frame_ns < cold.startup.first_frame_ns){
+      cold = run;
+    }
+  }
+
+  within = s->windows_loaded <= RESUME_BUDGET_WINDOWS &&
+           s->resource_bytes <= RESUME_BUDGET_RESOURCE_BYTES &&
+           s->persist_reads <= RESUME_BUDGET_PERSIST_READS;
+
+  printf("resume: %s %s after %llu s closed shows \"%s / %s / %s\", %s a straight run\n",
+         RESUME_MENU, RESUME_PROGRAM, (unsigned long long)(RESUME_CLOSED_MS / 1000),
+         resumed.texts[0], resumed.texts[1], resumed.texts[2], same ? "same as" : "DIFFERENT FROM");
+  printf("resume: %u windows, %u layers, %u resource bytes, %u persist reads, %llu ns to the event loop (%s)\n",
+         s->windows_loaded, s->layers_created, s->resource_bytes, s->persist_reads,
+         (unsigned long long)s->startup_ns, within ? "within budget" : "OVER BUDGET");
+  printf("cold start: %u windows, %u layers, %u B of heap, %u resource bytes, %u persist reads, %llu ns to the event loop, %llu ns to the first frame (best of %d)\n",
+         cold.startup.windows_loaded, cold.startup.layers_created, cold.startup.heap_peak,
+         cold.startup.resource_bytes, cold.startup.persist_reads,
+         (unsigned long long)cold.startup.startup_ns, (unsigned long long)cold.startup.first_frame_ns,
+         COLD_START_RUNS);
+
+  if (!same || !within){
+    exit(1);
+  }
+}
+
+// Walks the intervals of a program, checking the second each starts at and
+// that seeking to any of its seconds finds it. Zero length intervals are
+// never found, the seek lands on what follows.
+static bool check_program_seek(const struct program *program, int *seeks){
+  struct interval interval;
+  struct interval found;
+  int total_s = program_total_s(program);
+  int end_s = total_s == PROGRAM_FOREVER ? SCRUB_FOREVER_S : total_s;
+  int start_s = 0;
+  int index;
+  int i;
+
+  for (i = 0; start_s < end_s && program_interval_at(program, i, &interval); i++){
+    if (interval.start_s != start_s){
+      return false;
+    }
+    for (int second = start_s; second < start_s + interval.duration; second++, (*seeks)++){
+      if (!program_seek(program, second, &index, &found) || index != i ||
+          found.start_s != start_s || found.type != interval.type){
+        return false;
+      }
+    }
+    start_s += interval.duration;
+  }
+
+  if (total_s == PROGRAM_FOREVER){
+    return start_s >= end_s;
+  }
+  return i == program_interval_count(program) && start_s == total_s &&
+         !program_seek(program, total_s, &index, &found);
+}
+
+// Scrubs the resume workout with long presses, then lets it settle like the
+// straight run does.
+static void scrub_script(void *ctx){
+  struct resume_run *r = ctx;
+  int row;
+
+  sim_run_for(REACTION_MS);
+  if ((row = find_row(RESUME_MENU)) < 0){
+    return;
+  }
+  sim_menu_select(row);
+  if ((row = find_row(RESUME_PROGRAM)) < 0){
+    return;
+  }
+  r->found = true;
+  sim_menu_select(row);
+  for (int i = 0; i < SCRUB_PRESSES_FORWARD; i++){
+    sim_long_click(BUTTON_ID_DOWN);
+  }
+  for (int i = 0; i < SCRUB_PRESSES_BACK; i++){
+    sim_long_click(BUTTON_ID_UP);
+  }
+  sim_run_for(r->run_ms);
+  record_texts(r);
+}
+
+static void print_scrub(void){
+  struct resume_run straight = { .run_ms = (SCRUB_PRESSES_FORWARD - SCRUB_PRESSES_BACK) * SCRUB_STEP_S * 1000 + RESUME_SETTLE_MS };
+  struct resume_run scrubbed = { .run_ms = RESUME_SETTLE_MS };
+  struct catalog_menu menu;
+  struct catalog_program record;
+  static struct program program;
+  int programs = 0;
+  int seeks = 0;
+  bool ok = true;
+  bool same = true;
+
+  sim_storage_reset();
+  catalog_init();
+  for (int m = 0; m < catalog_menu_count() && catalog_load_menu(m, &menu); m++){
+    for (int p = 0; p < menu.program_count; p++){
+      int id = menu.first_program + p;
+
+      if (!catalog_load_program_record(id, &record) || !catalog_load_program(id, &record, &program) ||
+          !check_program_seek(&program, &seeks)){
+        printf("scrub: seek DISAGREES with a walk in %s %s\n", menu.label.title, record.label.title);
+        ok = false;
+      }
+      programs++;
+    }
+  }
+
+  launch_fresh(resume_start_script, &straight);
+  launch_fresh(scrub_script, &scrubbed);
+  for (int i = 0; i < TIMER_TEXTS; i++){
+    same = same && strcmp(straight.texts[i], scrubbed.texts[i]) == 0;
+  }
+
+  printf("scrub: %d seeks over %d programs %s a walk through the intervals\n", seeks, programs, ok ? "agree with" : "DISAGREE WITH");
+  printf("scrub: %s %s %d min forward and %d back shows \"%s / %s / %s / %s\", %s a straight run\n",
+         RESUME_MENU, RESUME_PROGRAM, SCRUB_PRESSES_FORWARD * SCRUB_STEP_S / 60, SCRUB_PRESSES_BACK * SCRUB_STEP_S / 60,
+         scrubbed.texts[0], scrubbed.texts[1], scrubbed.texts[2], scrubbed.texts[3],
+         same ? "same as" : "DIFFERENT FROM");
+
+  if (!ok || !same || !straight.found || !scrubbed.found){
+    exit(1);
+  }
+}
+
+// Runs a workout of the first menu to its end, or abandons it.
+static void history_script(void *ctx){
+  int n = *(int *)ctx;
+
+  sim_run_for(REACTION_MS);
+  sim_menu_select(0);
+  sim_menu_select(n % sim_menu_rows());
+
+  if (n % 2){
+    sim_run_for(HISTORY_ABANDON_AFTER_MS);
+    sim_click(BUTTON_ID_DOWN);
+    sim_click(BUTTON_ID_DOWN);
+    sim_click(BUTTON_ID_BACK);
+  } else {
+    sim_run_until_idle(cap_ms);
+  }
+}
+
+// Runs workouts back to back and reads the history ring back.
+static void print_history(void){
+  struct history_record record;
+  uint32_t bytes;
+  int kept = 0;
+  bool ok = true;
+
+  sim_storage_reset();
+  sim_stats_reset();
+  for (int n = 0; n < HISTORY_CHECK_WORKOUTS; n++){
+    sim_launch(history_script, &n);
+  }
+  bytes = sim_stats.persist_bytes;
+
+  while (history_load(kept, &record)){
+    int n = HISTORY_CHECK_WORKOUTS - 1 - kept;
+
+    ok = ok && record.sequence == (uint32_t)n &&
+         record.outcome == (n % 2 ? HISTORY_ABANDONED : HISTORY_COMPLETED) &&
+         record.skips == (n % 2 ? 2 : 0);
+    kept++;
+  }
+  ok = ok && kept == (HISTORY_CHECK_WORKOUTS < HISTORY_SLOTS ? HISTORY_CHECK_WORKOUTS : HISTORY_SLOTS);
+
+  history_load(0, &record);
+  printf("history: %d workouts, %d records kept, %u bytes written per workout (%u per record), newest #%u lasted %u s over %u intervals, %s\n",
+         HISTORY_CHECK_WORKOUTS, kept, bytes / HISTORY_CHECK_WORKOUTS, (unsigned)sizeof(record),
+         (unsigned)record.sequence, (unsigned)record.active_s, record.interval_count,
+         ok ? "consistent" : "INCONSISTENT");
+  if (!ok){
+    exit(1);
+  }
+}
+
+// A trace recorded, or synthesized, at the detector's rate: x, y, z in mg,
+// and from its header the reference cadence and when the wearer stood
+// still, in seconds.
+struct accel_trace {
+  char name[LABEL_SIZE];
+  int rate_hz;
+  double reference_spm;
+  int still_count;
+  int still_s[AUTO_PAUSE_MAX_STOPS][2];
+  uint32_t count;
+  int16_t (*xyz)[3];
+  AccelData *samples;
+};
+
+static bool load_trace(const char *path, struct accel_trace *t){
+  FILE *f = fopen(path, "r");
+  char line[128];
+  uint32_t size = 0;
+  int16_t x, y, z;
+  int start, end;
+
+  if (!f){
+    return false;
+  }
+  t->rate_hz = 0;
+  t->reference_spm = -1;
+  t->still_count = 0;
+  t->count = 0;
+  t->xyz = NULL;
+  while (fgets(line, sizeof(line), f)){
+    if (line[0] == '#'){
+      sscanf(line, "# rate_hz %d", &t->rate_hz);
+      sscanf(line, "# cadence_spm %lf", &t->reference_spm);
+      if (sscanf(line, "# still_s %d %d", &start, &end) == 2 && t->still_count < AUTO_PAUSE_MAX_STOPS){
+        t->still_s[t->still_count][0] = start;
+        t->still_s[t->still_count][1] = end;
+        t->still_count++;
+      }
+    } else if (sscanf(line, "%hd,%hd,%hd", &x, &y, &z) == 3){
+      if (t->count == size){
+        size = size ? size * 2 : 1024;
+        t->xyz = realloc(t->xyz, size * sizeof(*t->xyz));
+      }
+      t->xyz[t->count][0] = x;
+      t->xyz[t->count][1] = y;
+      t->xyz[t->count][2] = z;
+      t->count++;
+    }
+  }
+  fclose(f);
+
+  t->samples = calloc(t->count, sizeof(AccelData));
+  for (uint32_t i = 0; i < t->count; i++){
+    t->samples[i].x = t->xyz[i][0];
+    t->samples[i].y = t->xyz[i][1];
+    t->samples[i].z = t->xyz[i][2];
+  }
+  return t->count > 0 && t->rate_hz > 0 && t->reference_spm >= 0;
+}
+
+static int compare_traces(const void *a, const void *b){
+  return strcmp(((const struct accel_trace *)a)->name, ((const struct accel_trace *)b)->name);
+}
+
+// Steps per minute the detector finds in a trace, fed in batches like the
+// service does.
+static double trace_cadence(const struct accel_trace *t){
+  struct cadence c;
+  int steps = 0;
+
+  cadence_init(&c);
+  for (uint32_t i = 0; i < t->count; i += CADENCE_BATCH){
+    uint32_t n = t->count - i < CADENCE_BATCH ? t->count - i : CADENCE_BATCH;
+
+    steps += cadence_process(&c, t->samples + i, n);
+  }
+  return steps * 60.0 * t->rate_hz / t->count;
+}
+
+static uint64_t host_ns(void){
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// Runs the resume workout into its first run interval with the wrist
+// playing a trace, and pauses so the cadence is drawn.
+struct cadence_run {
+  bool found;
+  char text[TEXT_SIZE];
+};
+
+static void cadence_script(void *ctx){
+  struct cadence_run *r = ctx;
+  int row;
+
+  sim_run_for(REACTION_MS);
+  if ((row = find_row(RESUME_MENU)) < 0){
+    return;
+  }
+  sim_menu_select(row);
+  if ((row = find_row(RESUME_PROGRAM)) < 0){
+    return;
+  }
+  r->found = true;
+  sim_menu_select(row);
+  sim_run_for(CADENCE_RUN_MS);
+  sim_click(BUTTON_ID_SELECT);
+  timer_text(TIMER_TEXTS - 1, r->text, TEXT_SIZE);
+}
+
+// Every trace of SIM_TRACES_DIR, loaded on first use.
+static struct accel_trace traces[CADENCE_MAX_TRACES];
+static int trace_count = -1;
+
+static void load_traces(void){
+  DIR *dir;
+  struct dirent *entry;
+
+  if (trace_count >= 0){
+    return;
+  }
+  if (!(dir = opendir(SIM_TRACES_DIR))){
+    printf("\ncadence: no traces in %s\n", SIM_TRACES_DIR);
+    exit(1);
+  }
+  trace_count = 0;
+  while ((entry = readdir(dir)) && trace_count < CADENCE_MAX_TRACES){
+    struct accel_trace *t = &traces[trace_count];
+    char path[512];
+    size_t length = strlen(entry->d_name);
+
+    if (length < 5 || strcmp(entry->d_name + length - 4, ".csv") != 0){
+      continue;
+    }
+    snprintf(path, sizeof(path), "%s/%s", SIM_TRACES_DIR, entry->d_name);
+    snprintf(t->name, LABEL_SIZE, "%.*s", (int)(length - 4), entry->d_name);
+    if (!load_trace(path, t)){
+      printf("\ncadence: %s is not a trace\n", path);
+      exit(1);
+    }
+    trace_count++;
+  }
+  closedir(dir);
+  qsort(traces, trace_count, sizeof(traces[0]), compare_traces);
+}
+
+static void print_cadence(void){
+  struct accel_trace *running = NULL;
+  struct cadence_run run = { .found = false };
+  bool ok = true;
+  const char *spm;
+  int shown = -1;
+
+  load_traces();
+  printf("\n");
+  for (int i = 0; i < trace_count; i++){
+    struct accel_trace *t = &traces[i];
+    double found = trace_cadence(t);
+    double tolerance = t->reference_spm * CADENCE_TOLERANCE_PERCENT / 100;
+    bool within = t->rate_hz == CADENCE_SAMPLING_HZ;
+    uint64_t started;
+    uint64_t ns;
+
+    if (tolerance < CADENCE_TOLERANCE_SPM){
+      tolerance = CADENCE_TOLERANCE_SPM;
+    }
+    within = within && found >= t->reference_spm - tolerance && found <= t->reference_spm + tolerance;
+
+    started = host_ns();
+    for (int pass = 0; pass < CADENCE_BENCH_PASSES; pass++){
+      trace_cadence(t);
+    }
+    ns = host_ns() - started;
+
+    printf("cadence %-10s %6u samples at %d Hz: %5.1f spm against %5.1f, %5.1f ns per sample, %s\n",
+           t->name, t->count, t->rate_hz, found, t->reference_spm,
+           (double)ns / ((double)t->count * CADENCE_BENCH_PASSES), within ? "within tolerance" : "OFF");
+    ok = ok && within;
+    if (!running && strncmp(t->name, "run", 3) == 0){
+      running = t;
+    }
+  }
+
+  if (running){
+    sim_accel_play((const int16_t (*)[3])running->xyz, running->count, running->rate_hz);
+    launch_fresh(cadence_script, &run);
+    sim_accel_play(NULL, 0, 0);
+
+    spm = strstr(run.text, " spm");
+    if (spm){
+      while (spm > run.text && spm[-1] >= '0' && spm[-1] <= '9'){
+        spm--;
+      }
+      shown = atoi(spm);
+    }
+    ok = ok && run.found && shown >= running->reference_spm - CADENCE_TOLERANCE_SPM &&
+         shown <= running->reference_spm + CADENCE_TOLERANCE_SPM;
+    printf("cadence: %s %s on %s shows \"%s\", %s\n", RESUME_MENU, RESUME_PROGRAM, running->name, run.text,
+           ok ? "consistent" : "INCONSISTENT");
+  }
+
+  if (!ok || !running){
+    exit(1);
+  }
+}
+
+// Plays a trace from the start of a workout and records when it pauses and
+// resumes, and what the watch woke up for while running and paused.
+enum auto_pause_test {
+  AUTO_PAUSE_REPLAY,
+  AUTO_PAUSE_TAP,
+  AUTO_PAUSE_MANUAL,
+};
+
+struct auto_pause_run {
+  const struct accel_trace *trace;
+  const char *menu;
+  const char *program;
+  enum auto_pause_test test;
+
+  bool found;
+  bool ok;
+  int pauses;
+  int paused_ms[AUTO_PAUSE_MAX_STOPS];
+  int resumed_ms[AUTO_PAUSE_MAX_STOPS];
+  uint64_t running_ms;
+  uint64_t resting_ms;
+  uint32_t running_wakeups;
+  uint32_t resting_wakeups;
+};
+
+// Runs for ms in small steps, noting every pause and resume.
+static void auto_pause_follow(struct auto_pause_run *r, uint64_t started, uint64_t ms){
+  uint64_t end = sim_now_ms() + ms;
+
+  while (sim_now_ms() < end){
+    bool paused = control_block_is_paused();
+    uint32_t wakeups = sim_stats.wakeups;
+    int at;
+
+    sim_run_for(AUTO_PAUSE_STEP_MS);
+    at = (int)(sim_now_ms() - started);
+    if (paused){
+      r->resting_ms += AUTO_PAUSE_STEP_MS;
+      r->resting_wakeups += sim_stats.wakeups - wakeups;
+    } else {
+      r->running_ms += AUTO_PAUSE_STEP_MS;
+      r->running_wakeups += sim_stats.wakeups - wakeups;
+    }
+    if (!paused && control_block_is_paused() && r->pauses < AUTO_PAUSE_MAX_STOPS){
+      r->paused_ms[r->pauses] = at;
+      r->resumed_ms[r->pauses] = -1;
+    } else if (paused && !control_block_is_paused() && r->pauses < AUTO_PAUSE_MAX_STOPS){
+      r->resumed_ms[r->pauses++] = at;
+    }
+  }
+}
+
+static void auto_pause_script(void *ctx){
+  struct auto_pause_run *r = ctx;
+  const struct accel_trace *t = r->trace;
+  uint64_t started;
+  uint32_t batches;
+  int row;
+
+  sim_run_for(REACTION_MS);
+  if ((row = find_row(r->menu)) < 0){
+    return;
+  }
+  sim_menu_select(row);
+  if ((row = find_row(r->program)) < 0){
+    return;
+  }
+  r->found = true;
+  sim_accel_play((const int16_t (*)[3])t->xyz, t->count, t->rate_hz);
+  started = sim_now_ms();
+  sim_menu_select(row);
+
+  switch (r->test){
+    case AUTO_PAUSE_REPLAY:
+      auto_pause_follow(r, started, (uint64_t)t->count * 1000 / t->rate_hz);
+      break;
+    case AUTO_PAUSE_TAP:
+      // Paused at the first stop, a tap is enough.
+      auto_pause_follow(r, started, t->still_s[0][0] * 1000 + AUTO_PAUSE_LAG_MS);
+      r->ok = control_block_is_paused();
+      sim_accel_tap(ACCEL_AXIS_Z, 1);
+      r->ok = r->ok && !control_block_is_paused();
+      break;
+    case AUTO_PAUSE_MANUAL:
+      // Paused with select while moving, nothing is sampled until select.
+      sim_run_for(AUTO_PAUSE_MANUAL_AT_MS);
+      sim_click(BUTTON_ID_SELECT);
+      batches = sim_stats.accel_batches;
+      sim_run_for(AUTO_PAUSE_MANUAL_MS);
+      r->ok = control_block_is_paused() && sim_stats.accel_batches == batches;
+      sim_click(BUTTON_ID_SELECT);
+      r->ok = r->ok && !control_block_is_paused();
+      break;
+  }
+  sim_accel_play(NULL, 0, 0);
+}
+
+static void print_auto_pause(void){
+  const struct accel_trace *stop_go = NULL;
+  bool ok = true;
+
+  load_traces();
+  printf("\n");
+  for (int i = 0; i < trace_count; i++){
+    const struct accel_trace *t = &traces[i];
+    struct auto_pause_run r = { .trace = t, .menu = RESUME_MENU, .program = RESUME_PROGRAM, .test = AUTO_PAUSE_REPLAY };
+    int caught = 0;
+
+    if (t->still_count == 0 || t->still_s[0][0] == 0){
+      continue;
+    }
+    launch_fresh(auto_pause_script, &r);
+
+    printf("auto-pause %-10s stops at", t->name);
+    for (int s = 0; s < t->still_count; s++){
+      printf(" %d-%d", t->still_s[s][0], t->still_s[s][1]);
+    }
+    printf(" s, paused at");
+    for (int p = 0; p < r.pauses; p++){
+      printf(" %.1f-%.1f", r.paused_ms[p] / 1000.0, r.resumed_ms[p] / 1000.0);
+    }
+    for (int s = 0; s < t->still_count && s < r.pauses; s++){
+      int start_ms = t->still_s[s][0] * 1000;
+      int end_ms = t->still_s[s][1] * 1000;
+
+      if (r.paused_ms[s] >= start_ms && r.paused_ms[s] <= start_ms + AUTO_PAUSE_LAG_MS &&
+          r.resumed_ms[s] >= end_ms && r.resumed_ms[s] <= end_ms + AUTO_RESUME_LAG_MS){
+        caught++;
+      }
+    }
+    printf(" s, %d of %d caught, %d false\n", caught, t->still_count, r.pauses - caught);
+    printf("auto-pause %-10s %.2f wakeups per second paused, %.2f running\n", t->name,
+           r.resting_wakeups * 1000.0 / (r.resting_ms ? r.resting_ms : 1),
+           r.running_wakeups * 1000.0 / (r.running_ms ? r.running_ms : 1));
+    ok = ok && r.found && caught == t->still_count && r.pauses == caught;
+    if (!stop_go){
+      stop_go = t;
+    }
+  }
+
+  if (stop_go){
+    struct auto_pause_run tap = { .trace = stop_go, .menu = RESUME_MENU, .program = RESUME_PROGRAM, .test = AUTO_PAUSE_TAP };
+    struct auto_pause_run manual = { .trace = stop_go, .menu = RESUME_MENU, .program = RESUME_PROGRAM, .test = AUTO_PAUSE_MANUAL };
+    struct auto_pause_run periodic = { .trace = stop_go, .menu = AUTO_PAUSE_PERIODIC_MENU, .program = AUTO_PAUSE_PERIODIC_PROGRAM, .test = AUTO_PAUSE_REPLAY };
+
+    launch_fresh(auto_pause_script, &tap);
+    launch_fresh(auto_pause_script, &manual);
+    launch_fresh(auto_pause_script, &periodic);
+    printf("auto-pause: a tap %s, select %s, %s %s %s\n",
+           tap.ok ? "resumes at once" : "DOES NOT RESUME",
+           manual.ok ? "pauses until select" : "PAUSE DOES NOT HOLD",
+           AUTO_PAUSE_PERIODIC_MENU, AUTO_PAUSE_PERIODIC_PROGRAM,
+           periodic.pauses == 0 ? "never pauses" : "PAUSES");
+    ok = ok && tap.found && tap.ok && manual.found && manual.ok && periodic.found && periodic.pauses == 0;
+  }
+
+  if (!ok || !stop_go){
+    exit(1);
+  }
+}
+
+struct press {
+  uint32_t ms;
+  ButtonId button;
+  bool long_press;
+};
+
+struct button_trace {
+  char name[LABEL_SIZE];
+  int count;
+  struct press presses[REPLAY_MAX_PRESSES];
+};
+
+static bool load_button_trace(const char *path, struct button_trace *t){
+  FILE *f = fopen(path, "r");
+  char line[128];
+
+  if (!f){
+    return false;
+  }
+  t->count = 0;
+  while (fgets(line, sizeof(line), f) && t->count < REPLAY_MAX_PRESSES){
+    struct press *p = &t->presses[t->count];
+    char button[16];
+    char kind[16] = "";
+    unsigned ms;
+
+    if (line[0] == '#' || line[0] == '\n'){
+      continue;
+    }
+    if (sscanf(line, "%u %15s %15s", &ms, button, kind) < 2){
+      fclose(f);
+      return false;
+    }
+    p->ms = ms;
+    p->long_press = strcmp(kind, "long") == 0;
+    if (strcmp(button, "up") == 0){
+      p->button = BUTTON_ID_UP;
+    } else if (strcmp(button, "down") == 0){
+      p->button = BUTTON_ID_DOWN;
+    } else if (strcmp(button, "select") == 0){
+      p->button = BUTTON_ID_SELECT;
+    } else if (strcmp(button, "back") == 0){
+      p->button = BUTTON_ID_BACK;
+    } else {
+      fclose(f);
+      return false;
+    }
+    t->count++;
+  }
+  fclose(f);
+  return t->count > 0;
+}
+
+static int compare_button_traces(const void *a, const void *b){
+  return strcmp(((const struct button_trace *)a)->name, ((const struct button_trace *)b)->name);
+}
+
+static int load_button_traces(struct button_trace *traces, int max){
+  DIR *dir = opendir(SIM_TRACES_DIR);
+  struct dirent *entry;
+  int count = 0;
+
+  while (dir && (entry = readdir(dir)) && count < max){
+    char path[512];
+    size_t length = strlen(entry->d_name);
+
+    if (length < 6 || strcmp(entry->d_name + length - 5, ".keys") != 0){
+      continue;
+    }
+    snprintf(path, sizeof(path), "%s/%s", SIM_TRACES_DIR, entry->d_name);
+    snprintf(traces[count].name, LABEL_SIZE, "%.*s", (int)(length - 5), entry->d_name);
+    if (!load_button_trace(path, &traces[count])){
+      printf("\nreplay: %s is not a button trace\n", path);
+      exit(1);
+    }
+    count++;
+  }
+  if (dir){
+    closedir(dir);
+  }
+  qsort(traces, count, sizeof(traces[0]), compare_button_traces);
+  return count;
+}
+
+struct replay_run {
+  const struct button_trace *trace;
+  bool found;
+  struct sim_stats stats;
+  int answered;
+  int pending;
+  uint32_t ms[SIM_MAX_LATENCIES];
+  uint64_t ns[SIM_MAX_LATENCIES];
+};
+
+static int compare_u32(const void *a, const void *b){
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static int compare_u64(const void *a, const void *b){
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static void replay_script(void *ctx){
+  struct replay_run *r = ctx;
+  uint32_t elapsed_ms = 0;
+  int row;
+
+  sim_run_for(REACTION_MS);
+  if ((row = find_row(RESUME_MENU)) < 0){
+    return;
+  }
+  sim_menu_select(row);
+  if ((row = find_row(RESUME_PROGRAM)) < 0){
+    return;
+  }
+  r->found = true;
+  sim_menu_select(row);
+  sim_stats_reset();
+
+  for (int i = 0; i < r->trace->count; i++){
+    const struct press *p = &r->trace->presses[i];
+
+    if (p->ms > elapsed_ms){
+      sim_run_for(p->ms - elapsed_ms);
+      elapsed_ms = p->ms;
+    }
+    if (p->long_press){
+      sim_long_click(p->button);
+    } else {
+      sim_click(p->button);
+    }
+  }
+  sim_run_for(REPLAY_AFTER_MS);
+
+  r->stats = sim_stats;
+  r->answered = sim_latency_count;
+  r->pending = sim_inputs_pending;
+  for (int i = 0; i < sim_latency_count; i++){
+    r->ms[i] = sim_latencies[i].ms;
+    r->ns[i] = sim_latencies[i].ns;
+  }
+  qsort(r->ms, r->answered, sizeof(r->ms[0]), compare_u32);
+  qsort(r->ns, r->answered, sizeof(r->ns[0]), compare_u64);
+}
+
+// Percentile of a sorted sample.
+#define PERCENTILE(values, count, p) ((count) ? (values)[((count) - 1) * (p) / 100] : 0)
+
+static void print_replay(void){
+  static struct button_trace traces[REPLAY_MAX_TRACES];
+  static struct replay_run r;
+  int count = load_button_traces(traces, REPLAY_MAX_TRACES);
+  bool ok = count > 0;
+
+  printf("\n");
+  for (int i = 0; i < count; i++){
+    bool within;
+
+    r = (struct replay_run){ .trace = &traces[i] };
+    launch_fresh(replay_script, &r);
+    within = r.found && r.pending == 0 && r.answered == traces[i].count &&
+             r.ms[r.answered - 1] <= REPLAY_BUDGET_MS;
+
+    printf("replay %-8s %2d presses, %2d answered, %3u timer calls, %3u frames, %4u invalidations, latency p50 %u p90 %u p99 %u max %u ms, host p50 %.1f p99 %.1f us (%s)\n",
+           traces[i].name, traces[i].count, r.answered, r.stats.timer_calls, r.stats.frames,
+           r.stats.invalidations,
+           PERCENTILE(r.ms, r.answered, 50), PERCENTILE(r.ms, r.answered, 90),
+           PERCENTILE(r.ms, r.answered, 99), r.answered ? r.ms[r.answered - 1] : 0,
+           PERCENTILE(r.ns, r.answered, 50) / 1000.0, PERCENTILE(r.ns, r.answered, 99) / 1000.0,
+           within ? "within budget" : "OVER BUDGET");
+    ok = ok && within;
+  }
+  if (!ok){
+    exit(1);
+  }
+}
+
+// Heap peaks on the main menu, a program menu and the timer.
+struct ram_run {
+  bool found;
+  uint32_t main;
+  uint32_t menu;
+  uint32_t timer;
+  size_t noted;
+};
+
+static void ram_script(void *ctx){
+  struct ram_run *r = ctx;
+  int row;
+
+  sim_run_for(REACTION_MS);
+  r->main = sim_stats.heap_peak;
+  if ((row = find_row(RESUME_MENU)) < 0){
+    return;
+  }
+  sim_stats_reset();
+  sim_menu_select(row);
+  r->menu = sim_stats.heap_peak;
+  if ((row = find_row(RESUME_PROGRAM)) < 0){
+    return;
+  }
+  r->found = true;
+  sim_stats_reset();
+  sim_menu_select(row);
+  sim_run_for(RAM_TIMER_RUN_MS);
+  r->timer = sim_stats.heap_peak;
+  r->noted = ram_peak_used();
+}
+
+static void print_ram(void){
+  struct ram_run r = { .found = false };
+  uint32_t peak;
+
+  sim_stats_reset();
+  launch_fresh(ram_script, &r);
+  peak = r.main > r.menu ? r.main : r.menu;
+  peak = peak > r.timer ? peak : r.timer;
+
+  printf("ram: heap at most %u B on the main menu, %u B on a program menu, %u B with the timer, %u B noted by the app (budget %u B, %s)\n",
+         r.main, r.menu, r.timer, (unsigned)r.noted, RAM_BUDGET_HEAP_BYTES,
+         r.found && peak <= RAM_BUDGET_HEAP_BYTES && r.noted > 0 && r.noted <= peak ? "within" : "OVER");
+  if (!r.found || peak > RAM_BUDGET_HEAP_BYTES || r.noted == 0 || r.noted > peak){
+    exit(1);
+  }
+}
+
+struct render_run {
+  bool found;
+  uint64_t ns;
+  struct sim_stats stats;
+};
+
+static void render_script(void *ctx){
+  struct render_run *r = ctx;
+  uint64_t started;
+  int row;
+
+  sim_run_for(REACTION_MS);
+  if ((row = find_row(RENDER_MENU)) < 0){
+    return;
+  }
+  sim_menu_select(row);
+  if ((row = find_row(RENDER_PROGRAM)) < 0){
+    return;
+  }
+  r->found = true;
+  sim_menu_select(row);
+  sim_stats_reset();
+  started = host_ns();
+  sim_run_for(RENDER_RUN_MS);
+  r->ns = host_ns() - started;
+  r->stats = sim_stats;
+}
+
+static void print_render(void){
+  struct render_run r = { .found = false };
+  uint32_t frames;
+  uint64_t area;
+
+  launch_fresh(render_script, &r);
+  frames = r.stats.frames ? r.stats.frames : 1;
+  area = r.stats.redraw_area / frames;
+
+  printf("render: %s %s for %u s, %u frames, %llu px repainted and %llu px filled per frame, %llu ns per frame on the host (%s the %u px of the time text layer)\n",
+         RENDER_MENU, RENDER_PROGRAM, RENDER_RUN_MS / 1000, r.stats.frames,
+         (unsigned long long)area, (unsigned long long)(r.stats.filled_area / frames),
+         (unsigned long long)(r.ns / frames), area < RENDER_TEXT_LAYER_AREA ? "under" : "NOT UNDER",
+         RENDER_TEXT_LAYER_AREA);
+  if (!r.found || area >= RENDER_TEXT_LAYER_AREA){
+    exit(1);
+  }
+}
+
+struct reminders_run {
+  bool with_reminders;
+  bool background;
+  bool by_worker;
+
+  bool found;
+  bool shown;
+  struct sim_stats stats;
+};
+
+// Vibrations felt: a merge cancels one to play them together.
+static uint32_t vibrations(const struct sim_stats *s){
+  return s->vibes_short + s->vibes_long + s->vibes_double + s->vibes_custom - s->vibes_cancelled;
+}
+
+// Turns the two periodic programs on as reminders, each row must say so.
+static void reminders_setup_script(void *ctx){
+  struct reminders_run *r = ctx;
+  const char *names[] = { REMINDERS_PERIODIC_A, REMINDERS_PERIODIC_B };
+  int row;
+
+  sim_run_for(REACTION_MS);
+  if ((row = find_row(REMINDERS_PERIODIC_MENU)) < 0){
+    return;
+  }
+  sim_menu_select(row);
+  r->shown = true;
+  for (int i = 0; i < 2; i++){
+    if ((row = find_row(names[i])) < 0){
+      r->shown = false;
+      return;
+    }
+    sim_menu_long_select(row);
+    r->shown = r->shown && strcmp(sim_menu_row_subtitle(row), MESSAGE_REMINDER) == 0;
+  }
+}
+
+// Starts the workout, and runs it unless it goes on in the background.
+static void reminders_start_script(void *ctx){
+  struct reminders_run *r = ctx;
+  int row;
+
+  sim_run_for(REACTION_MS);
+  if ((row = find_row(REMINDERS_MENU)) < 0){
+    return;
+  }
+  sim_menu_select(row);
+  if ((row = find_row(REMINDERS_PROGRAM)) < 0){
+    return;
+  }
+  r->found = true;
+  sim_stats_reset();
+  sim_menu_select(row);
+  if (!r->background){
+    sim_run_until_idle(cap_ms);
+  }
+}
+
+static void run_reminders(struct reminders_run *r){
+  sim_storage_reset();
+  sim_worker_slot(r->by_worker);
+  if (r->with_reminders){
+    sim_launch(reminders_setup_script, r);
+  }
+  sim_launch(reminders_start_script, r);
+  while (r->background && relaunch(r->by_worker)){
+  }
+  r->stats = sim_stats;
+  sim_worker_slot(false);
+}
+
+// Finds a program of the catalog by menu and program title. Returns its
+// number, -1 if there is none.
+static int find_catalog_program(const char *menu_title, const char *title, struct catalog_program *record){
+  struct catalog_menu menu;
+
+  for (int m = 0; m < catalog_menu_count() && catalog_load_menu(m, &menu); m++){
+    for (int p = 0; strcmp(menu.label.title, menu_title) == 0 && p < menu.program_count; p++){
+      int id = menu.first_program + p;
+
+      if (catalog_load_program_record(id, record) && strcmp(record->label.title, title) == 0){
+        return id;
+      }
+    }
+  }
+  return -1;
+}
+
+// Loads a program of the catalog by menu and program title.
+static bool load_catalog_program(const char *menu_title, const char *title, struct program *program){
+  struct catalog_program record;
+  int id = find_catalog_program(menu_title, title, &record);
+
+  return id >= 0 && catalog_load_program(id, &record, program);
+}
+
+// Tries to start the malformed program from its menu.
+struct malformed_run {
+  bool found;
+  bool started;
+};
+
+static void malformed_script(void *ctx){
+  struct malformed_run *r = ctx;
+  int row;
+
+  sim_run_for(REACTION_MS);
+  if ((row = find_row(MALFORMED_MENU)) < 0){
+    return;
+  }
+  sim_menu_select(row);
+  if ((row = find_row(MALFORMED_PROGRAM)) < 0){
+    return;
+  }
+  r->found = true;
+  sim_menu_select(row);
+  sim_run_for(REACTION_MS);
+  r->started = sim_menu_rows() == 0;
+}
+
+// Syncs the malformed program with its first segment set to type and
+// seconds, then tries to load and start it.
+static bool run_malformed(int type, int seconds){
+  static struct program program;
+  struct catalog_program record;
+  struct sync_run sync = { 0 };
+  struct malformed_run run = { .found = false };
+  bool loaded = false;
+  int id;
+
+  sim_storage_reset();
+  sim_phone_reset();
+  catalog_init();
+  if ((id = find_catalog_program(MALFORMED_MENU, MALFORMED_PROGRAM, &record)) >= 0){
+    sim_phone_set_segment(id, type, seconds);
+    sim_launch(sync_script, &sync);
+    catalog_init();
+    loaded = catalog_load_program(id, &record, &program);
+  }
+
+  // Started, it would never get past its first boundary, or show its type.
+  if (id >= 0 && !loaded){
+    sim_launch(malformed_script, &run);
+  }
+  sim_storage_reset();
+  sim_phone_reset();
+  catalog_init();
+
+  return id >= 0 && sync.phone.requests > 0 && !loaded && run.found && !run.started;
+}
+
+static void print_malformed(void){
+  static const struct {
+    const char *what;
+    int type;
+    int seconds;
+  } cases[] = {
+    { "a segment of 0 s", -1, 0 },
+    { "a segment over 99:59", -1, PROGRAM_MAX_SEGMENT_S + 1 },
+    { "opcode 7", MALFORMED_OPCODE, 60 },
+  };
+  bool ok = true;
+
+  printf("\n");
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++){
+    bool dropped = run_malformed(cases[i].type, cases[i].seconds);
+
+    printf("malformed: %s %s synced with %s: %s\n", MALFORMED_MENU, MALFORMED_PROGRAM, cases[i].what,
+           dropped ? "dropped, the menu stays up" : "LOADED OR STARTED");
+    ok = ok && dropped;
+  }
+  if (!ok){
+    exit(1);
+  }
+}
+
+// Seconds of the program at which a reminder goes off and nothing else
+// buzzes: no boundary, no warning before one.
+static int reminder_only_seconds(const struct program *program, int period_a, int period_b, int *reminders){
+  int total_s = program_total_s(program);
+  int count = 0;
+
+  *reminders = 0;
+  for (int second = 1; second < total_s; second++){
+    struct interval interval;
+    int index;
+    bool alert = false;
+
+    if (second % period_a && second % period_b){
+      continue;
+    }
+    *reminders += (second % period_a == 0) + (second % period_b == 0);
+    for (index = 0; program_interval_at(program, index, &interval); index++){
+      int end_s = interval.start_s + interval.duration;
+
+      alert = alert || end_s == second ||
+              (interval.duration > BOUNDARY_WARNING_S && end_s - BOUNDARY_WARNING_S == second);
+    }
+    count += !alert;
+  }
+  return count;
+}
+
+static void print_reminders(void){
+  struct reminders_run plain = { .with_reminders = false };
+  struct reminders_run with = { .with_reminders = true };
+  struct reminders_run plain_bg = { .with_reminders = false, .background = true };
+  struct reminders_run with_bg = { .with_reminders = true, .background = true };
+  static struct program program;
+  static struct program periodic;
+  int period_a = 0;
+  int period_b = 0;
+  int reminders = 0;
+  int own = 0;
+  struct interval interval;
+  bool ok;
+
+  sim_storage_reset();
+  catalog_init();
+  if (load_catalog_program(REMINDERS_PERIODIC_MENU, REMINDERS_PERIODIC_A, &periodic) &&
+      program_interval_at(&periodic, 0, &interval)){
+    period_a = interval.duration;
+  }
+  if (load_catalog_program(REMINDERS_PERIODIC_MENU, REMINDERS_PERIODIC_B, &periodic) &&
+      program_interval_at(&periodic, 0, &interval)){
+    period_b = interval.duration;
+  }
+  if (period_a && period_b && load_catalog_program(REMINDERS_MENU, REMINDERS_PROGRAM, &program)){
+    own = reminder_only_seconds(&program, period_a, period_b, &reminders);
+  }
+
+  run_reminders(&plain);
+  run_reminders(&with);
+  run_reminders(&plain_bg);
+  run_reminders(&with_bg);
+
+  printf("\nreminders: %s %s with %s and %s: %d reminders, %d seconds with nothing else buzzing\n",
+         REMINDERS_MENU, REMINDERS_PROGRAM, REMINDERS_PERIODIC_A, REMINDERS_PERIODIC_B, reminders, own);
+  printf("reminders: %u -> %u timer callbacks, %u -> %u timer calls, %u -> %u vibrations, %u merged\n",
+         plain.stats.timers, with.stats.timers, plain.stats.timer_calls, with.stats.timer_calls,
+         vibrations(&plain.stats), vibrations(&with.stats), with.stats.vibes_cancelled);
+  printf("reminders: in the background %u -> %u launches, %u -> %u vibrations\n",
+         plain_bg.stats.launches, with_bg.stats.launches, vibrations(&plain_bg.stats), vibrations(&with_bg.stats));
+
+  ok = own > 0 && plain.found && with.found && with.shown && with_bg.found &&
+       with.stats.timers == plain.stats.timers &&
+       vibrations(&with.stats) == vibrations(&plain.stats) + own &&
+       with_bg.stats.launches == plain_bg.stats.launches + own &&
+       vibrations(&with_bg.stats) == vibrations(&plain_bg.stats) + own;
+  printf("reminders: %s\n", ok ? "no wakeup added, one vibration per second" : "EXTRA WAKEUPS OR VIBRATIONS");
+  if (!ok){
+    exit(1);
+  }
+}
+
+static void print_drift(void){
+  struct drift_run plain = { .pause = false };
+  struct drift_run paused = { .pause = true };
+  int64_t off_ms;
+
+  launch_fresh(drift_script, &plain);
+  launch_fresh(drift_script, &paused);
+  if (!plain.found || !paused.found){
+    printf("\ndrift: %s %s NOT FOUND\n", DRIFT_MENU, DRIFT_PROGRAM);
+    exit(1);
+  }
+  off_ms = (int64_t)(paused.elapsed_ms - paused.paused_ms) - (int64_t)plain.elapsed_ms;
+  printf("\ndrift: %s %s paused %llu ms in total ended %lld ms off\n",
+         DRIFT_MENU, DRIFT_PROGRAM, (unsigned long long)paused.paused_ms, (long long)off_ms);
+
+  if (off_ms != 0){
+    exit(1);
+  }
+}
+
+static void print_header(void){
+  printf("%-10s %-22s %8s %8s %7s %7s %6s %7s %7s %9s %7s %9s %7s %9s %6s\n",
+         "menu", "program", "secs", "wakeups", "ticks", "timers", "os_tmr",
+         "frames", "invals", "area_kpx", "skipped", "saved_kpx", "logs", "persist_B", "bounds");
+}
+
+static void print_row(const char *menu, const char *title, const struct sim_stats *s, uint64_t elapsed_ms, bool finished){
+  printf("%-10s %-22s %7llu%c %8u %7u %7u %6u %7u %7u %9llu %7u %9llu %7u %9u %6u\n",
+         menu, title,
+         (unsigned long long)(elapsed_ms / 1000), finished ? ' ' : '+',
+         s->wakeups, s->ticks, s->timers, s->timer_calls,
+         s->frames, s->invalidations,
+         (unsigned long long)(s->redraw_area / 1000),
+         s->skipped_layers, (unsigned long long)(s->skipped_area / 1000),
+         s->logs, s->persist_bytes, s->vibes_long + s->vibes_double);
+}
+
+static void print_background_header(void){
+  printf("%-10s %-22s %8s %10s %8s %8s %7s %9s %6s\n",
+         "menu", "program", "secs", "relaunches", "alive_s", "wakeups",
+         "frames", "persist_B", "bounds");
+}
+
+static void print_background_row(const char *menu, const char *title, const struct sim_stats *s, uint64_t elapsed_ms, bool finished){
+  printf("%-10s %-22s %7llu%c %10u %8llu %8u %7u %9u %6u\n",
+         menu, title,
+         (unsigned long long)(elapsed_ms / 1000), finished ? ' ' : '+',
+         s->launches, (unsigned long long)(s->alive_ms / 1000), s->wakeups,
+         s->frames, s->persist_bytes, s->vibes_long + s->vibes_double);
+}
+
+// Energy report: what each workout of the first table would have drawn,
+// per term of the model in millijoules, and its average power.
+struct workout_energy {
+  char menu[LABEL_SIZE];
+  char title[LABEL_SIZE];
+  struct sim_stats stats;
+  uint64_t elapsed_ms;
+  bool finished;
+};
+
+#define ENERGY_MAX_WORKOUTS 64
+
+static struct workout_energy energy_runs[ENERGY_MAX_WORKOUTS];
+static int energy_run_count = 0;
+
+static void note_energy(const char *menu, const char *title, const struct sim_stats *s, uint64_t elapsed_ms, bool finished){
+  struct workout_energy *e;
+
+  if (energy_run_count == ENERGY_MAX_WORKOUTS){
+    return;
+  }
+  e = &energy_runs[energy_run_count++];
+  snprintf(e->menu, sizeof(e->menu), "%s", menu);
+  snprintf(e->title, sizeof(e->title), "%s", title);
+  e->stats = *s;
+  e->elapsed_ms = elapsed_ms;
+  e->finished = finished;
+}
+
+static void print_energy_row(const char *menu, const char *title, const struct sim_stats *s, uint64_t elapsed_ms, bool finished){
+  double uj[ENERGY_TERMS];
+  double total = energy_total_uj(s);
+
+  energy_account(s, uj);
+  printf("%-10s %-22s %7llu%c %9.1f %7.3f",
+         menu, title,
+         (unsigned long long)(elapsed_ms / 1000), finished ? ' ' : '+',
+         total / 1000, elapsed_ms ? total / elapsed_ms : 0.0);
+  for (int term = 0; term < ENERGY_TERMS; term++){
+    printf(" %10.1f", uj[term] / 1000);
+  }
+  printf("\n");
+}
+
+static void add_stats(struct sim_stats *total, const struct sim_stats *s);
+
+static void print_energy(void){
+  struct sim_stats total = { 0 };
+  uint64_t total_ms = 0;
+
+  printf("\nenergy, in uJ per unit:");
+  for (int term = 0; term < ENERGY_TERMS; term++){
+    printf(" %s %g", energy_term_name(term), energy_costs[term]);
+  }
+  printf("\n%-10s %-22s %8s %9s %7s", "menu", "program", "secs", "total_mJ", "avg_mW");
+  for (int term = 0; term < ENERGY_TERMS; term++){
+    printf(" %10s", energy_term_name(term));
+  }
+  printf("\n");
+
+  for (int i = 0; i < energy_run_count; i++){
+    struct workout_energy *e = &energy_runs[i];
+
+    print_energy_row(e->menu, e->title, &e->stats, e->elapsed_ms, e->finished);
+    add_stats(&total, &e->stats);
+    total_ms += e->elapsed_ms;
+  }
+  print_energy_row("total", "", &total, total_ms, true);
+}
+
+static void add_stats(struct sim_stats *total, const struct sim_stats *s){
+  total->wakeups += s->wakeups;
+  total->ticks += s->ticks;
+  total->timers += s->timers;
+  total->timer_calls += s->timer_calls;
+  total->frames += s->frames;
+  total->invalidations += s->invalidations;
+  total->redraw_area += s->redraw_area;
+  total->skipped_layers += s->skipped_layers;
+  total->skipped_area += s->skipped_area;
+  total->logs += s->logs;
+  total->vibes_short += s->vibes_short;
+  total->vibes_long += s->vibes_long;
+  total->vibes_double += s->vibes_double;
+  total->vibes_custom += s->vibes_custom;
+  total->vibes_cancelled += s->vibes_cancelled;
+  total->vibe_ms += s->vibe_ms;
+  total->accel_samples += s->accel_samples;
+  total->launches += s->launches;
+  total->alive_ms += s->alive_ms;
+  total->persist_writes += s->persist_writes;
+  total->persist_bytes += s->persist_bytes;
+  total->worker_messages += s->worker_messages;
+  total->worker_timers += s->worker_timers;
+}
+
+// Worker check: every workout that ends in the background again,
+// relaunched by the worker instead of wakeups. It must buzz the same
+// boundaries from as many launches and be gone once the workout is over;
+// the reminders run of F210K Week 6 too.
+static void print_worker(int main_rows){
+  struct sim_stats wakeup_total = { 0 };
+  struct sim_stats worker_total = { 0 };
+  struct reminders_run wakeup_reminders = { .with_reminders = true, .background = true };
+  struct reminders_run worker_reminders = { .with_reminders = true, .background = true, .by_worker = true };
+  int workouts = 0;
+  int endless = 0;
+  int mismatched = 0;
+  int left_running = 0;
+  bool ok;
+
+  for (int m = 0; m < main_rows; m++){
+    struct workout menu = { .menu_row = m };
+
+    launch_fresh(enumerate_script, &menu);
+
+    for (int p = 0; p < menu.program_rows; p++){
+      struct workout w = { .menu_row = m, .program_row = p };
+      struct sim_stats by_wakeup;
+
+      run_background(&w, false);
+      by_wakeup = sim_stats;
+      if (!w.finished){
+        endless++;
+        continue;
+      }
+      add_stats(&wakeup_total, &sim_stats);
+
+      run_background(&w, true);
+      add_stats(&worker_total, &sim_stats);
+      workouts++;
+      mismatched += sim_stats.launches != by_wakeup.launches ||
+                    sim_stats.vibes_long + sim_stats.vibes_double != by_wakeup.vibes_long + by_wakeup.vibes_double;
+      left_running += !w.finished || app_worker_is_running();
+    }
+  }
+  sim_storage_reset();
+
+  run_reminders(&wakeup_reminders);
+  run_reminders(&worker_reminders);
+
+  printf("\nworker: %d workouts closed after the start, %d endless ones left out: %u -> %u relaunches, %u -> %u boundaries, %llu -> %llu s alive\n",
+         workouts, endless, wakeup_total.launches, worker_total.launches,
+         wakeup_total.vibes_long + wakeup_total.vibes_double, worker_total.vibes_long + worker_total.vibes_double,
+         (unsigned long long)(wakeup_total.alive_ms / 1000), (unsigned long long)(worker_total.alive_ms / 1000));
+  printf("worker: %u timer callbacks, %u messages, %.1f per relaunch\n",
+         worker_total.worker_timers, worker_total.worker_messages,
+         worker_total.launches ? (double)worker_total.worker_messages / worker_total.launches : 0.0);
+  printf("worker: %s with reminders %u -> %u launches, %u -> %u vibrations\n",
+         REMINDERS_PROGRAM, wakeup_reminders.stats.launches, worker_reminders.stats.launches,
+         vibrations(&wakeup_reminders.stats), vibrations(&worker_reminders.stats));
+
+  ok = workouts > 0 && mismatched == 0 && left_running == 0 &&
+       worker_total.launches > workouts && worker_reminders.found &&
+       worker_reminders.stats.launches == wakeup_reminders.stats.launches &&
+       vibrations(&worker_reminders.stats) == vibrations(&wakeup_reminders.stats);
+  printf("worker: %s\n", ok ? "same launches and buzzes as wakeups, gone after every workout" :
+                              "LAUNCHES OR BUZZES DIFFER, OR A WORKER LEFT RUNNING");
+  if (!ok){
+    exit(1);
+  }
+}
+
+// Runs the low power workout, plugs the watch in, and records what the
+// timer shows and the timer callbacks over a minute either side.
+struct low_power_run {
+  bool found;
+  char period_low[TEXT_SIZE];
+  char time_low[TEXT_SIZE];
+  char period_plugged[TEXT_SIZE];
+  char time_plugged[TEXT_SIZE];
+  uint32_t timers_low;
+  uint32_t timers_plugged;
+};
+
+static void low_power_script(void *ctx){
+  struct low_power_run *r = ctx;
+  uint32_t timers;
+  int row;
+
+  sim_run_for(REACTION_MS);
+  if ((row = find_row(LOW_POWER_MENU)) < 0){
+    return;
+  }
+  sim_menu_select(row);
+  if ((row = find_row(LOW_POWER_PROGRAM)) < 0){
+    return;
+  }
+  r->found = true;
+  sim_menu_select(row);
+  sim_run_for(LOW_POWER_PLUG_MS - LOW_POWER_PROBE_MS);
+
+  timers = sim_stats.timers;
+  sim_run_for(LOW_POWER_PROBE_MS);
+  r->timers_low = sim_stats.timers - timers;
+  timer_text(0, r->time_low, TEXT_SIZE);
+  timer_text(2, r->period_low, TEXT_SIZE);
+
+  sim_battery_set(LOW_POWER_BATTERY, true);
+  timers = sim_stats.timers;
+  sim_run_for(LOW_POWER_PROBE_MS);
+  r->timers_plugged = sim_stats.timers - timers;
+  timer_text(0, r->time_plugged, TEXT_SIZE);
+  timer_text(2, r->period_plugged, TEXT_SIZE);
+}
+
+static bool starts_with(const char *text, const char *prefix){
+  return strncmp(text, prefix, strlen(prefix)) == 0;
+}
+
+static void print_low_power(int main_rows){
+  struct sim_stats full = { 0 };
+  struct sim_stats low = { 0 };
+  struct low_power_run run = { .found = false };
+  int workouts = 0;
+  int mismatched = 0;
+  int costlier = 0;
+  double full_uj;
+  double low_uj;
+  bool ok;
+
+  sim_battery_set(LOW_POWER_BATTERY, false);
+  for (int m = 0; m < main_rows; m++){
+    struct workout menu = { .menu_row = m };
+
+    launch_fresh(enumerate_script, &menu);
+
+    for (int p = 0; p < menu.program_rows && workouts < energy_run_count; p++){
+      struct workout w = { .menu_row = m, .program_row = p };
+      const struct sim_stats *before = &energy_runs[workouts++].stats;
+
+      launch_fresh(workout_script, &w);
+      add_stats(&full, before);
+      add_stats(&low, &sim_stats);
+      mismatched += vibrations(&sim_stats) - sim_stats.vibes_short != before->vibes_long + before->vibes_double;
+      costlier += energy_total_uj(&sim_stats) >= energy_total_uj(before);
+    }
+  }
+  launch_fresh(low_power_script, &run);
+  sim_battery_set(100, false);
+
+  full_uj = energy_total_uj(&full);
+  low_uj = energy_total_uj(&low);
+  printf("\nlow power: %d workouts at %d%% battery: %.1f -> %.1f mJ, %.0f%% saved\n",
+         workouts, LOW_POWER_BATTERY, full_uj / 1000, low_uj / 1000, full_uj ? 100 * (1 - low_uj / full_uj) : 0.0);
+  printf("low power: %u -> %u wakeups, %u -> %u invalidations, %u -> %u vibration ms, %u -> %u accelerometer samples\n",
+         full.wakeups, low.wakeups, full.invalidations, low.invalidations,
+         full.vibe_ms, low.vibe_ms, full.accel_samples, low.accel_samples);
+  printf("low power: %s %s shows \"%s\" \"%s\" with %u timer callbacks a minute, plugged in \"%s\" \"%s\" with %u\n",
+         LOW_POWER_MENU, LOW_POWER_PROGRAM, run.time_low, run.period_low, run.timers_low,
+         run.time_plugged, run.period_plugged, run.timers_plugged);
+
+  ok = workouts == energy_run_count && workouts > 0 && mismatched == 0 && costlier == 0 &&
+       low.accel_samples == 0 && run.found &&
+       run.time_low[0] == '\0' && starts_with(run.period_low, "low power ") &&
+       run.time_plugged[0] != '\0' && starts_with(run.period_plugged, "period ") &&
+       run.timers_low < run.timers_plugged;
+  printf("low power: %s\n", ok ? "same boundaries for less energy in every workout, back to full when plugged in" :
+                                  "BOUNDARIES DIFFER, NO SAVING, OR THE MODE DOES NOT SHOW");
+  if (!ok){
+    exit(1);
+  }
+}
+
+// Closes the resume workout, syncs the phone's catalog with one program
+// edited, and reopens the app.
+static void resume_after_sync(int program_id, struct resume_run *reopened){
+  struct sync_run sync = { 0 };
+
+  sim_phone_edit_program(program_id, SYNC_EDIT_SECONDS);
+  sim_launch(sync_script, &sync);
+  sim_launch(resume_probe_script, reopened);
+}
+
+static void print_resume_sync(void){
+  struct resume_run started = { .run_ms = RESUME_RUN_MS };
+  struct resume_run kept = { .run_ms = REACTION_MS };
+  struct resume_run dropped = { .run_ms = REACTION_MS };
+  struct catalog_program record;
+  int id;
+  bool ok;
+
+  launch_fresh(resume_start_script, &started);
+  catalog_init();
+  id = find_catalog_program(RESUME_MENU, RESUME_PROGRAM, &record);
+  if (started.found && id >= 0 && id != RESUME_SYNC_OTHER_PROGRAM){
+    sim_phone_reset();
+    resume_after_sync(RESUME_SYNC_OTHER_PROGRAM, &kept);
+    resume_after_sync(id, &dropped);
+  }
+  sim_storage_reset();
+  catalog_init();
+
+  ok = started.found && kept.timer && !dropped.timer;
+  printf("resume: %s %s %s after a sync editing another program, %s after one editing it\n",
+         RESUME_MENU, RESUME_PROGRAM, kept.timer ? "resumed" : "DROPPED",
+         dropped.timer ? "RESUMED" : "dropped");
+  if (!ok){
+    exit(1);
+  }
+}
+
+int main(int argc, char **argv){
+  struct sim_stats total = { 0 };
+  uint64_t total_ms = 0;
+  int main_rows = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "vc:e:")) != -1){
+    switch (opt){
+      case 'v':
+        sim_verbose = true;
+        break;
+      case 'c':
+        cap_ms = (uint64_t)atoi(optarg) * 60 * 1000;
+        break;
+      case 'e':
+        if (!energy_set_costs(optarg)){
+          fprintf(stderr, "%s: bad energy costs: %s\n", argv[0], optarg);
+          return 2;
+        }
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-v] [-c cap_minutes] [-e name=cost,...]\n", argv[0]);
+        return 2;
+    }
+  }
+
+  launch_fresh(count_script, &main_rows);
+
+  print_header();
+  for (int m = 0; m < main_rows; m++){
+    struct workout menu = { .menu_row = m };
+
+    launch_fresh(enumerate_script, &menu);
+
+    for (int p = 0; p < menu.program_rows; p++){
+      struct workout w = { .menu_row = m, .program_row = p };
+
+      launch_fresh(workout_script, &w);
+      print_row(menu.menu_title, w.title, &sim_stats, w.elapsed_ms, w.finished);
+      note_energy(menu.menu_title, w.title, &sim_stats, w.elapsed_ms, w.finished);
+      add_stats(&total, &sim_stats);
+      total_ms += w.elapsed_ms;
+    }
+  }
+  print_row("total", "", &total, total_ms, true);
+  print_energy();
+
+  memset(&total, 0, sizeof(total));
+  total_ms = 0;
+  printf("\nbackground:\n");
+  print_background_header();
+  for (int m = 0; m < main_rows; m++){
+    struct workout menu = { .menu_row = m };
+
+    launch_fresh(enumerate_script, &menu);
+
+    for (int p = 0; p < menu.program_rows; p++){
+      struct workout w = { .menu_row = m, .program_row = p };
+
+      run_background(&w, false);
+      print_background_row(menu.menu_title, w.title, &sim_stats, w.elapsed_ms, w.finished);
+      add_stats(&total, &sim_stats);
+      total_ms += w.elapsed_ms;
+    }
+  }
+  print_background_row("total", "", &total, total_ms, true);
+
+  print_menus(main_rows);
+  print_sync();
+  print_sync_budget();
+  print_resync();
+  print_malformed();
+  print_drift();
+  print_resume();
+  print_resume_sync();
+  print_scrub();
+  print_history();
+  print_ram();
+  print_render();
+  print_cadence();
+  print_auto_pause();
+  print_replay();
+  print_reminders();
+  print_worker(main_rows);
+  print_low_power(main_rows);
+
+  return 0;
+}
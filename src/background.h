@@ -0,0 +1,26 @@
+#pragma once
+
+// Background worker (worker_src/worker.c): carries a workout while the app
+// is closed. A worker can neither draw nor vibrate, so the app is launched
+// for every alert all the same; the worker only keeps the time of the next
+// one, to the millisecond and without the limits of wakeups, and launches
+// the app a little ahead of it so that the app's own timer fires it. The
+// app still falls back on a wakeup when the watch's one worker slot is
+// taken by another app.
+//
+// Both sides talk through AppWorkerMessage, only when the workout changes
+// hands. Shared by the worker, so nothing here includes pebble.h.
+
+// App to worker, closing mid-workout: the next alert is data0 << 16 | data1
+// milliseconds from now, data2 its cookie, see session_suspend.
+#define BACKGROUND_MSG_ALERT 1
+
+// App to worker, launched: the app times the workout itself again.
+#define BACKGROUND_MSG_STAND_DOWN 2
+
+// Worker to app, answering BACKGROUND_MSG_STAND_DOWN: data0 is the cookie
+// of the alert the worker launched the app for, 0 if it did not.
+#define BACKGROUND_MSG_LAUNCHED 3
+
+// How long before an alert the worker launches the app.
+#define BACKGROUND_LEAD_MS 1000
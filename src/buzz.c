@@ -0,0 +1,131 @@
+#include "pebble.h"
+#include "buzz.h"
+#include "scheduler.h"
+
+static const uint32_t buzz_short_segments[] = { BUZZ_SHORT_MS };
+static const uint32_t buzz_long_segments[] = { BUZZ_LONG_MS };
+static const uint32_t buzz_double_segments[] = { BUZZ_SHORT_MS, BUZZ_DOUBLE_GAP_MS, BUZZ_SHORT_MS };
+
+// Shorter vibrations, see buzz_set_low_power.
+static bool low_power = false;
+
+// The last vibration and when it started. The motor reads the durations
+// from here while it plays.
+static struct {
+  int64_t start_ms;
+  uint32_t segments[BUZZ_MAX_SEGMENTS];
+  int count;
+} playing;
+
+// Is the motor on at the given time into a pattern.
+static bool buzz_on_at(const uint32_t *segments, int count, int64_t ms){
+  for (int i = 0; i < count; i++){
+    if (ms < segments[i]){
+      return i % 2 == 0;
+    }
+    ms -= segments[i];
+  }
+  return false;
+}
+
+// First time after the given one at which a pattern, started at offset,
+// turns the motor on or off, or -1.
+static int64_t buzz_next_edge(const uint32_t *segments, int count, int64_t offset, int64_t ms){
+  int64_t edge = offset;
+
+  for (int i = 0; i < count; i++){
+    edge += segments[i];
+    if (edge > ms){
+      return edge;
+    }
+  }
+  return -1;
+}
+
+// Merges a pattern into what is left of the one playing, elapsed_ms into
+// it. Returns the segment count of the result, in merged.
+static int buzz_merge(int64_t elapsed_ms, const uint32_t *durations, int count, uint32_t *merged){
+  int64_t at = 0;
+  int64_t since = 0;
+  bool on = true;
+  int n = 0;
+
+  for (;;){
+    int64_t old_edge = buzz_next_edge(playing.segments, playing.count, -elapsed_ms, at);
+    int64_t new_edge = buzz_next_edge(durations, count, 0, at);
+    bool state = buzz_on_at(playing.segments, playing.count, at + elapsed_ms) ||
+                 buzz_on_at(durations, count, at);
+
+    if (state != on){
+      if (n == BUZZ_MAX_SEGMENTS){
+        break;
+      }
+      merged[n++] = (uint32_t)(at - since);
+      since = at;
+      on = state;
+    }
+    if (old_edge < 0 && new_edge < 0){
+      break;
+    }
+    at = old_edge < 0 ? new_edge : new_edge < 0 ? old_edge : old_edge < new_edge ? old_edge : new_edge;
+  }
+
+  // Segments alternate from on, end on one with the motor on.
+  return n % 2 ? n : n - 1;
+}
+
+static void buzz(const uint32_t *durations, int count, void (*pulse)()){
+  int64_t now = scheduler_now_ms();
+  uint32_t shortened[BUZZ_MAX_SEGMENTS];
+  uint32_t merged[BUZZ_MAX_SEGMENTS];
+
+  if (low_power){
+    if (count > BUZZ_MAX_SEGMENTS){
+      count = BUZZ_MAX_SEGMENTS;
+    }
+    for (int i = 0; i < count; i++){
+      shortened[i] = i % 2 || durations[i] / 2 < BUZZ_LOW_POWER_MIN_MS ? durations[i] : durations[i] / 2;
+    }
+    durations = shortened;
+    pulse = NULL;
+  }
+
+  if (playing.count > 0 && now - playing.start_ms < BUZZ_MERGE_MS){
+    count = buzz_merge(now - playing.start_ms, durations, count, merged);
+    durations = merged;
+    pulse = NULL;
+    vibes_cancel();
+  }
+  if (count > BUZZ_MAX_SEGMENTS){
+    count = BUZZ_MAX_SEGMENTS;
+  }
+
+  memcpy(playing.segments, durations, count * sizeof(*durations));
+  playing.count = count;
+  playing.start_ms = now;
+  if (pulse){
+    pulse();
+  } else if (count > 0){
+    vibes_enqueue_custom_pattern((VibePattern){ .durations = playing.segments, .num_segments = count });
+  }
+}
+
+void buzz_set_low_power(bool on){
+  low_power = on;
+}
+
+void buzz_short(){
+  buzz(buzz_short_segments, 1, vibes_short_pulse);
+}
+
+void buzz_long(){
+  buzz(buzz_long_segments, 1, vibes_long_pulse);
+}
+
+void buzz_double(){
+  buzz(buzz_double_segments, 3, vibes_double_pulse);
+}
+
+void buzz_pattern(const uint32_t *durations, int count){
+  buzz(durations, count, NULL);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "pebble.h"
+
+// Buzz: every vibration of the app goes through here. Alerts that go off
+// within a second of each other, a boundary, its warning or any number of
+// reminders, make one vibration instead of several in a row: a pattern
+// asked for while the last one is under a second old is merged into what
+// is left of it, the motor on wherever either is on.
+#define BUZZ_MERGE_MS 1000
+
+// Longest merged pattern, on and off segments; the rest is cut.
+#define BUZZ_MAX_SEGMENTS 16
+
+// What the system pulses are taken to last when merged.
+#define BUZZ_SHORT_MS 100
+#define BUZZ_LONG_MS 500
+#define BUZZ_DOUBLE_GAP_MS 100
+
+// In low power mode every vibration plays its on segments at half length,
+// not under this.
+#define BUZZ_LOW_POWER_MIN_MS 50
+
+void buzz_set_low_power(bool low_power);
+
+void buzz_short();
+void buzz_long();
+void buzz_double();
+
+// On and off durations in milliseconds, starting with on.
+void buzz_pattern(const uint32_t *durations, int count);
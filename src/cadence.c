@@ -0,0 +1,105 @@
+#include "pebble.h"
+#include "cadence.h"
+
+// Band-pass around 3 Hz with a Q of 0.7 at 25 Hz, in Q14. It passes strides
+// of 100 to 220 steps per minute and takes out gravity and the arm swing.
+#define CADENCE_B0 5380
+#define CADENCE_B2 -5380
+#define CADENCE_A1 -16043
+#define CADENCE_A2 5623
+#define CADENCE_SHIFT 14
+
+// Threshold floor in mg, and the part of the envelope above it that counts.
+#define CADENCE_MIN_THRESHOLD 40
+#define CADENCE_ENVELOPE_DIV 4
+
+// The envelope loses 1/16 per sample, about a tenth of it every second.
+#define CADENCE_ENVELOPE_DECAY 4
+
+// Steps are at least this many samples apart (240 steps per minute), and
+// 5/8 of the recent step interval.
+#define CADENCE_MIN_SAMPLES (CADENCE_SAMPLING_HZ * 60 / 240)
+#define CADENCE_START_SAMPLES (CADENCE_SAMPLING_HZ * 60 / 150)
+
+static int32_t cadence_abs(int32_t value){
+  return value < 0 ? -value : value;
+}
+
+// Length of the vector, within a few percent and without a square root:
+// the largest component, half the middle one and a quarter of the least.
+int32_t cadence_magnitude(const AccelData *sample){
+  int32_t a = cadence_abs(sample->x);
+  int32_t b = cadence_abs(sample->y);
+  int32_t c = cadence_abs(sample->z);
+  int32_t t;
+
+  if (a < b){
+    t = a; a = b; b = t;
+  }
+  if (b < c){
+    t = b; b = c; c = t;
+  }
+  if (a < b){
+    t = a; a = b; b = t;
+  }
+  return a + (b >> 1) + (c >> 2);
+}
+
+void cadence_init(struct cadence *cadence){
+  *cadence = (struct cadence){
+    .interval = CADENCE_START_SAMPLES,
+  };
+}
+
+// Feed a batch of samples. Returns the steps found in it.
+int cadence_process(struct cadence *cadence, const AccelData *samples, uint32_t count){
+  int steps = 0;
+
+  for (uint32_t i = 0; i < count; i++){
+    int32_t x;
+    int32_t y;
+    int32_t threshold;
+    int32_t refractory;
+
+    // The motor shakes the samples taken while it runs, hold the last one.
+    x = samples[i].did_vibrate ? cadence->x1 : cadence_magnitude(&samples[i]);
+    y = (CADENCE_B0 * x + CADENCE_B2 * cadence->x2 -
+         CADENCE_A1 * cadence->y1 - CADENCE_A2 * cadence->y2) >> CADENCE_SHIFT;
+    cadence->x2 = cadence->x1;
+    cadence->x1 = x;
+    cadence->y2 = cadence->y1;
+    cadence->y1 = y;
+
+    if (cadence_abs(y) > cadence->envelope){
+      cadence->envelope = cadence_abs(y);
+    } else {
+      cadence->envelope -= cadence->envelope >> CADENCE_ENVELOPE_DECAY;
+    }
+    threshold = cadence->envelope / CADENCE_ENVELOPE_DIV;
+    if (threshold < CADENCE_MIN_THRESHOLD){
+      threshold = CADENCE_MIN_THRESHOLD;
+    }
+
+    if (cadence->since < INT16_MAX){
+      cadence->since++;
+    }
+    refractory = cadence->interval * 5 / 8;
+    if (refractory < CADENCE_MIN_SAMPLES){
+      refractory = CADENCE_MIN_SAMPLES;
+    }
+
+    if (y < -threshold){
+      cadence->armed = true;
+    } else if (y > threshold && cadence->armed && cadence->since >= refractory){
+      // A quarter of the way to this step's interval, unless it is a step
+      // after a stop.
+      if (cadence->since < 3 * cadence->interval){
+        cadence->interval += (cadence->since - cadence->interval) / 4;
+      }
+      cadence->armed = false;
+      cadence->since = 0;
+      steps++;
+    }
+  }
+  return steps;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "pebble.h"
+
+// Cadence: steps per minute from the wrist accelerometer, in integers only,
+// so a sample costs a few multiplies on the watch and the same code runs on
+// the host against recorded traces.
+//
+// Each sample is reduced to an approximate magnitude, which goes through a
+// band-pass biquad around the step rate. A step is counted when the filtered
+// signal swings from below -threshold to above +threshold. The threshold
+// follows a decaying envelope of the signal, with a floor that keeps a
+// still wrist at zero, and a refractory period of part of the recent step
+// interval keeps the bounce after an impact from counting twice.
+//
+// Samples come in batches of a second: 25 Hz is the lowest rate the service
+// offers that still catches a running stride, 10 Hz misses about a third of
+// the steps.
+#define CADENCE_SAMPLING_RATE ACCEL_SAMPLING_25HZ
+#define CADENCE_SAMPLING_HZ 25
+#define CADENCE_BATCH 25
+
+// An interval has a cadence once this much of it was counted.
+#define CADENCE_MIN_MS 10000
+
+struct cadence {
+    // Filter state: the last two magnitudes and outputs.
+    int32_t x1;
+    int32_t x2;
+    int32_t y1;
+    int32_t y2;
+
+    // Decaying peak of the filtered signal.
+    int32_t envelope;
+
+    // Samples since the last step, and the recent step interval.
+    int16_t since;
+    int16_t interval;
+
+    // The signal went below -threshold since the last step.
+    bool armed;
+};
+
+int32_t cadence_magnitude(const AccelData *sample);
+void cadence_init(struct cadence *cadence);
+int cadence_process(struct cadence *cadence, const AccelData *samples, uint32_t count);
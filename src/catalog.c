@@ -0,0 +1,115 @@
+#include "pebble.h"
+#include "catalog.h"
+#include "sync.h"
+#include "log.h"
+
+static ResHandle catalog_handle;
+static struct catalog_header catalog_header;
+
+// The catalog last synced from the phone replaces the resource. Its
+// manifest has the resource's header and menu table, programs have a key
+// each, see sync.h.
+static bool catalog_synced;
+
+// Offsets of the tables within the resource.
+static uint32_t catalog_menus_offset(){
+  return sizeof(struct catalog_header);
+}
+
+static uint32_t catalog_programs_offset(){
+  return catalog_menus_offset() + catalog_header.menu_count * sizeof(struct catalog_menu);
+}
+
+static uint32_t catalog_ops_offset(){
+  return catalog_programs_offset() + catalog_header.program_count * sizeof(struct catalog_program);
+}
+
+static bool catalog_read(uint32_t offset, void *buffer, size_t size){
+  if (catalog_synced){
+    return sync_read_manifest(offset, buffer, size);
+  }
+  return resource_load_byte_range(catalog_handle, offset, buffer, size) == size;
+}
+
+static bool catalog_read_header(){
+  return catalog_read(0, &catalog_header, sizeof(catalog_header)) &&
+         memcmp(catalog_header.magic, "RC", 2) == 0 &&
+         catalog_header.version == CATALOG_VERSION;
+}
+
+// Read the catalog header, from the synced catalog if there is one. Called
+// again after a sync. Returns false if the catalog is unusable.
+bool catalog_init(){
+  catalog_handle = resource_get_handle(RESOURCE_ID_PROGRAMS);
+  catalog_synced = sync_catalog_stored();
+
+  if (catalog_synced && !catalog_read_header()){
+    LOG_WARNING("catalog: bad synced catalog, using the resource");
+    catalog_synced = false;
+  }
+  if (!catalog_synced && !catalog_read_header()){
+    LOG_ERROR("catalog: bad program resource");
+    catalog_header.menu_count = 0;
+    return false;
+  }
+
+  LOG_DEBUG("catalog: %d menus, %d programs%s", catalog_header.menu_count, catalog_header.program_count, catalog_synced ? ", synced" : "");
+  return true;
+}
+
+// Number of menus in the catalog.
+int catalog_menu_count(){
+  return catalog_header.menu_count;
+}
+
+// Read one menu record.
+bool catalog_load_menu(int menu_index, struct catalog_menu *menu){
+  if (menu_index < 0 || menu_index >= catalog_header.menu_count){
+    return false;
+  }
+  return catalog_read(catalog_menus_offset() + menu_index * sizeof(struct catalog_menu), menu, sizeof(*menu));
+}
+
+// Read one program record, by its number in the program table.
+bool catalog_load_program_record(int program_id, struct catalog_program *program){
+  if (program_id < 0 || program_id >= catalog_header.program_count){
+    return false;
+  }
+  if (catalog_synced){
+    return sync_read_program(program_id, 0, program, sizeof(*program));
+  }
+  return catalog_read(catalog_programs_offset() + program_id * sizeof(struct catalog_program), program, sizeof(*program));
+}
+
+// Read the bytecode of a program, given its record, and build its prefix
+// sums.
+bool catalog_load_program(int program_id, const struct catalog_program *program, struct program *code){
+  bool read;
+
+  if (program->op_count > PROGRAM_MAX_OPS){
+    LOG_ERROR("catalog: program of %d ops", program->op_count);
+    return false;
+  }
+
+  code->op_count = program->op_count;
+  if (catalog_synced){
+    read = sync_read_program(program_id, sizeof(*program), code->ops, code->op_count * sizeof(uint16_t));
+  } else {
+    read = catalog_read(catalog_ops_offset() + program->first_op * sizeof(uint16_t), code->ops, code->op_count * sizeof(uint16_t));
+  }
+  if (read && !program_prepare(code)){
+    LOG_ERROR("catalog: program %d is malformed", program_id);
+    return false;
+  }
+  return read;
+}
+
+// Hash of a loaded program: the CRC-32 of its blob, record and ops, as the
+// manifest of a synced catalog has it (see sync.h). Tells whether a program
+// number still stands for the same program after a sync.
+uint32_t catalog_program_hash(const struct catalog_program *program, const struct program *code){
+  struct catalog_program record = *program;
+
+  record.first_op = 0;
+  return sync_crc32(sync_crc32(0, &record, sizeof(record)), code->ops, code->op_count * sizeof(uint16_t));
+}
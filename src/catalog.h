@@ -0,0 +1,54 @@
+#pragma once
+
+#include "pebble.h"
+#include "program.h"
+
+// The workout catalog lives in a packed binary resource built from
+// resources/programs.json by tools/pack_programs.py. Nothing but the header
+// stays in RAM: menu and program records are read one at a time as their
+// menu rows are drawn, and a program's bytecode when it is started. Once a
+// catalog has been synced from the phone it is read from persistent storage
+// instead, see sync.h.
+#define CATALOG_VERSION 2
+#define CATALOG_TITLE_SIZE 10
+#define CATALOG_SUBTITLE_SIZE 20
+
+struct catalog_header {
+    char magic[2];
+    uint8_t version;
+    uint8_t menu_count;
+    uint16_t program_count;
+    uint16_t reserved;
+};
+
+// Every menu and program record starts with the text shown in menus.
+struct catalog_label {
+    char title[CATALOG_TITLE_SIZE];
+    char subtitle[CATALOG_SUBTITLE_SIZE];
+};
+
+struct catalog_menu {
+    struct catalog_label label;
+
+    // Programs of this menu, as indexes into the program table.
+    uint16_t first_program;
+    uint8_t program_count;
+
+    // Unused, zero.
+    uint8_t flags;
+};
+
+struct catalog_program {
+    struct catalog_label label;
+
+    // Bytecode of this program, as indexes into the op table.
+    uint16_t first_op;
+    uint16_t op_count;
+};
+
+bool catalog_init();
+int catalog_menu_count();
+bool catalog_load_menu(int menu_index, struct catalog_menu *menu);
+bool catalog_load_program_record(int program_id, struct catalog_program *program);
+bool catalog_load_program(int program_id, const struct catalog_program *program, struct program *code);
+uint32_t catalog_program_hash(const struct catalog_program *program, const struct program *code);
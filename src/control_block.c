@@ -0,0 +1,380 @@
+#include "pebble.h"
+#include "control_block.h"
+#include "program.h"
+#include "cadence.h"
+#include "history.h"
+#include "scheduler.h"
+#include "log.h"
+#include "trace.h"
+
+// Control block is a structure that keeps track of all variables related to
+// the operation of the timer screen. There is a set of functions that is
+// used to abstract apps interaction with it and encapsulate the logic.
+static struct control_block cb = {.program = NULL}; // Empty control block.
+
+static void control_block_arm_boundary();
+static void control_block_boundary_callback(void *data);
+static bool control_block_advance();
+
+// Point in time the control block is at: the clock, or the moment it was
+// paused.
+static int64_t control_block_clock_ms(){
+  return cb.is_paused ? cb.pause_start_ms : scheduler_now_ms();
+}
+
+// Deadline of the current interval, pauses included.
+static int64_t control_block_deadline_ms(){
+  return cb.interval_end_ms + cb.interval_paused_ms;
+}
+
+// Start the current interval at the given time.
+static void control_block_start_interval(int64_t start_ms){
+  cb.interval_start_ms = start_ms;
+  cb.interval_end_ms = start_ms + (int64_t)cb.current_interval.duration * 1000;
+  cb.interval_paused_ms = 0;
+  cb.interval_skipped_ms = 0;
+  cb.interval_steps = 0;
+  cb.interval_step_ms = 0;
+
+  // A pause in progress carries over to the new interval.
+  if (cb.is_paused){
+    cb.pause_start_ms = start_ms;
+  }
+}
+
+// The current interval is left at the given time, tell the history how
+// long it actually ran.
+static void control_block_end_interval(int64_t at_ms){
+  history_interval_ended(cb.current_interval_index, (int)(at_ms - cb.interval_start_ms - cb.interval_paused_ms - cb.interval_skipped_ms));
+}
+
+// Initialize control block. Returns false if the program has no interval.
+bool control_block_init(const struct program *program, char *program_title, ControlBlockBoundaryHandler boundary_handler){
+  control_block_stop();
+
+  if (!program_interval_at(program, 0, &cb.current_interval)){
+    return false;
+  }
+
+  cb.program = program;
+  cb.program_title = program_title;
+  cb.current_interval_index = 0;
+  cb.intervals_total = program_interval_count(program);
+  cb.total_s = program_total_s(program);
+  cb.boundary_handler = boundary_handler;
+
+  cb.total_paused_ms = 0;
+  cb.is_paused = false;
+  cb.is_program_over = false;
+
+  control_block_start_interval(scheduler_now_ms());
+  control_block_arm_boundary();
+  trace(TRACE_START, cb.intervals_total);
+  return true;
+}
+
+// Snapshot the control block, see control_block_restore.
+void control_block_save(struct control_block_state *state){
+  state->interval_start_ms = cb.interval_start_ms;
+  state->pause_start_ms = cb.pause_start_ms;
+  state->interval_paused_ms = (int32_t)cb.interval_paused_ms;
+  state->interval_skipped_ms = (int32_t)cb.interval_skipped_ms;
+  state->total_paused_ms = (int32_t)cb.total_paused_ms;
+  state->interval_index = cb.current_interval_index;
+  state->is_paused = cb.is_paused;
+}
+
+// Skip the boundaries that passed since the snapshot was taken. The last
+// interval is left to its timer, which fires as soon as it is armed and
+// ends the program.
+static void control_block_catch_up(){
+  int64_t now = scheduler_now_ms();
+  int64_t deadline;
+
+  while (!cb.is_paused && control_block_deadline_ms() <= now && control_block_has_next_period()){
+    deadline = control_block_deadline_ms();
+    control_block_end_interval(deadline);
+    control_block_advance();
+    control_block_start_interval(deadline);
+  }
+}
+
+// Rebuild the control block from a snapshot taken by control_block_save,
+// possibly in an earlier run of the app. Returns false if the snapshot does
+// not fit the program.
+bool control_block_restore(const struct program *program, char *program_title, ControlBlockBoundaryHandler boundary_handler, const struct control_block_state *state){
+  control_block_stop();
+
+  if (!program_interval_at(program, state->interval_index, &cb.current_interval)){
+    return false;
+  }
+
+  cb.program = program;
+  cb.program_title = program_title;
+  cb.current_interval_index = state->interval_index;
+  cb.intervals_total = program_interval_count(program);
+  cb.total_s = program_total_s(program);
+  cb.boundary_handler = boundary_handler;
+
+  cb.is_paused = state->is_paused;
+  cb.is_program_over = false;
+  control_block_start_interval(state->interval_start_ms);
+  cb.pause_start_ms = state->pause_start_ms;
+  cb.interval_paused_ms = state->interval_paused_ms;
+  cb.interval_skipped_ms = state->interval_skipped_ms;
+  cb.total_paused_ms = state->total_paused_ms;
+
+  control_block_catch_up();
+  control_block_arm_boundary();
+  trace(TRACE_RESTORE, cb.current_interval_index);
+  return true;
+}
+
+// Stop the control block, no more boundaries will fire.
+void control_block_stop(){
+  scheduler_cancel(control_block_boundary_callback, NULL);
+}
+
+// Prints the status of the control block.
+void control_block_log_status(){
+  LOG_DEBUG("======================== CB STR ========================");
+  LOG_DEBUG("Intervals: \tTotal\tCurrent");
+  LOG_DEBUG("\t\t%d\t%d", cb.intervals_total, cb.current_interval_index);
+  LOG_DEBUG("Milliseconds left: %d", control_block_get_interval_ms_left());
+  LOG_DEBUG("Paused: %d, for %d ms in total", cb.is_paused, (int)cb.total_paused_ms);
+  LOG_DEBUG("Is program over: %d", cb.is_program_over);
+  LOG_DEBUG("======================== CB END ========================");
+}
+
+// Get Program's Title.
+char* control_block_get_program_title(){
+  return cb.program_title;
+}
+
+// Get number of milliseconds left in the current interval.
+int control_block_get_interval_ms_left(){
+  int64_t left = control_block_deadline_ms() - control_block_clock_ms();
+  return left > 0 ? (int)left : 0;
+}
+
+// Get number of seconds left in the current interval, rounded up so the
+// display reaches zero at the deadline.
+int control_block_get_interval_seconds_left(){
+  return (control_block_get_interval_ms_left() + 999) / 1000;
+}
+
+// Get the time the current interval ends at, were it not paused any more.
+int64_t control_block_get_deadline_ms(){
+  return control_block_deadline_ms();
+}
+
+// Get type of the interval (walk, run).
+int control_block_get_interval_type(){
+  return cb.current_interval.type;
+}
+
+// Get the index of the current interval, counting from 0.
+int control_block_get_interval_index(){
+  return cb.current_interval_index;
+}
+
+// Get the total number of intervals in the program, or PROGRAM_FOREVER.
+int control_block_get_intervals_total(){
+  return cb.intervals_total;
+}
+
+// Get how far into the program the timer is, in milliseconds as planned:
+// the start of the current interval and the part of it that is done.
+int control_block_get_position_ms(){
+  return (cb.current_interval.start_s + cb.current_interval.duration) * 1000 - control_block_get_interval_ms_left();
+}
+
+// When the program reaches the given point, in milliseconds as planned,
+// running on from now without a pause. Boundaries are at whole seconds of
+// the program, so are the times of whole seconds.
+int64_t control_block_get_time_at_ms(int position_ms){
+  return control_block_deadline_ms() - ((int64_t)(cb.current_interval.start_s + cb.current_interval.duration) * 1000 - position_ms);
+}
+
+// Get the length of the program in seconds, or PROGRAM_FOREVER.
+int control_block_get_total_s(){
+  return cb.total_s;
+}
+
+// Get the average cadence of the current interval in steps per minute, or
+// -1 until CADENCE_MIN_MS of it were counted.
+int control_block_get_cadence(){
+  if (cb.interval_step_ms < CADENCE_MIN_MS){
+    return -1;
+  }
+  return (int)((int64_t)cb.interval_steps * 60000 / cb.interval_step_ms);
+}
+
+// Returns true if the current interval is not the last one.
+bool control_block_has_next_period(){
+  return cb.intervals_total == PROGRAM_FOREVER || cb.current_interval_index + 1 < cb.intervals_total;
+}
+
+// Move to the next interval in the program. Returns false at the end.
+static bool control_block_advance(){
+  if (!control_block_has_next_period() ||
+      !program_interval_at(cb.program, cb.current_interval_index + 1, &cb.current_interval)){
+    return false;
+  }
+  cb.current_interval_index++;
+  return true;
+}
+
+// Fires at the deadline of the current interval.
+static void control_block_boundary_callback(void *data){
+  int64_t deadline = control_block_deadline_ms();
+
+  control_block_end_interval(deadline);
+
+  if (control_block_advance()){
+    // The next interval starts exactly at the deadline, however late the
+    // timer fired, so no error accumulates over the program.
+    control_block_start_interval(deadline);
+    control_block_arm_boundary();
+    trace(TRACE_BOUNDARY, cb.current_interval_index);
+
+    LOG_DEBUG("Next interval of the program, duration: %d", cb.current_interval.duration);
+    LOG_DEBUG("Interval %d of %d", cb.current_interval_index + 1, cb.intervals_total);
+  } else {
+    cb.is_program_over = true;
+    trace(TRACE_DONE, cb.intervals_total);
+    LOG_DEBUG("Completed the program!");
+  }
+
+  if (cb.boundary_handler){
+    cb.boundary_handler(cb.is_program_over);
+  }
+}
+
+// Post the boundary at the deadline of the current interval.
+static void control_block_arm_boundary(){
+  if (cb.is_paused || cb.is_program_over){
+    control_block_stop();
+    return;
+  }
+  scheduler_post(control_block_deadline_ms(), control_block_boundary_callback, NULL);
+}
+
+// Advance to the next period.
+void control_block_next_period(){
+  int64_t clock = control_block_clock_ms();
+
+  if (control_block_has_next_period()){
+    control_block_end_interval(clock);
+    control_block_advance();
+    control_block_start_interval(clock);
+    control_block_arm_boundary();
+    trace(TRACE_NEXT, cb.current_interval_index);
+  }
+}
+
+// Go back to the previos period.
+void control_block_previous_period(){
+  control_block_end_interval(control_block_clock_ms());
+
+  if (cb.current_interval_index > 0 &&
+      program_interval_at(cb.program, cb.current_interval_index - 1, &cb.current_interval)){
+    cb.current_interval_index--;
+  }
+
+  // The interval restarts from the top.
+  control_block_start_interval(control_block_clock_ms());
+  control_block_arm_boundary();
+  trace(TRACE_PREVIOUS, cb.current_interval_index);
+}
+
+// Jump to the given point of the program, in milliseconds as planned. The
+// interval there is found by binary search and starts as long ago as the
+// point is into it. A program that ends is kept to its last second, so a
+// jump does not end it.
+void control_block_seek(int position_ms){
+  int64_t clock = control_block_clock_ms();
+  int64_t last_ms = (int64_t)cb.total_s * 1000 - 1000;
+  struct interval interval;
+  int index;
+  int offset_ms;
+
+  if (cb.is_program_over){
+    return;
+  }
+  if (cb.total_s != PROGRAM_FOREVER && position_ms > last_ms){
+    position_ms = (int)last_ms;
+  }
+  if (position_ms < 0){
+    position_ms = 0;
+  }
+  if (!program_seek(cb.program, position_ms / 1000, &index, &interval)){
+    return;
+  }
+
+  control_block_end_interval(clock);
+  cb.current_interval = interval;
+  cb.current_interval_index = index;
+
+  // The part jumped over is not time run.
+  offset_ms = position_ms - interval.start_s * 1000;
+  control_block_start_interval(clock - offset_ms);
+  cb.interval_skipped_ms = offset_ms;
+  if (cb.is_paused){
+    cb.pause_start_ms = clock;
+  }
+  control_block_arm_boundary();
+  trace(TRACE_SEEK, (uint16_t)index);
+}
+
+// Count steps taken over the given time into the current interval. Steps
+// while paused are not part of it.
+void control_block_add_steps(int steps, int ms){
+  if (cb.is_paused || cb.is_program_over){
+    return;
+  }
+  cb.interval_steps += steps;
+  cb.interval_step_ms += ms;
+}
+
+// Pause the timer. The pause is counted separately from the interval.
+void control_block_pause(){
+  if (cb.is_paused || cb.is_program_over){
+    return;
+  }
+  cb.pause_start_ms = scheduler_now_ms();
+  cb.is_paused = true;
+  control_block_stop();
+  trace(TRACE_PAUSE, cb.current_interval_index);
+}
+
+// Resume the timer, pushing the deadline by the time spent paused.
+void control_block_resume(){
+  int64_t paused;
+
+  if (!cb.is_paused){
+    return;
+  }
+  paused = scheduler_now_ms() - cb.pause_start_ms;
+  cb.interval_paused_ms += paused;
+  cb.total_paused_ms += paused;
+  cb.is_paused = false;
+  control_block_arm_boundary();
+  trace(TRACE_RESUME, (uint16_t)(paused / 1000));
+}
+
+// Get the time spent paused in the whole program, a pause in progress
+// included.
+int control_block_get_paused_ms(){
+  return (int)(cb.total_paused_ms + (cb.is_paused ? scheduler_now_ms() - cb.pause_start_ms : 0));
+}
+
+// Returns true if the timer is paused.
+bool control_block_is_paused(){
+  return cb.is_paused;
+}
+
+// Returns true if the program is over.
+bool control_block_is_program_over(){
+  return cb.is_program_over;
+}
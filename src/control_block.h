@@ -0,0 +1,120 @@
+#pragma once
+
+#include "pebble.h"
+
+// Interval consists of type and duration, and the second of the program it
+// starts at when run as planned.
+struct interval {
+    int type;
+    int duration;
+    int start_s;
+};
+
+struct program;
+
+// Called when the current interval reaches its deadline, after the control
+// block has moved on. program_over is set when it was the last interval.
+typedef void (*ControlBlockBoundaryHandler)(bool program_over);
+
+// Control block is a control structure used
+// by the Running Coach to loop through the
+// running program.
+//
+// Timing is deadline based: the control block keeps the absolute start and
+// end of the current interval (in milliseconds) and the time spent paused,
+// and works out the remaining time from the clock. Interval boundaries are
+// posted to the scheduler for the exact deadline.
+//
+// Intervals are decoded from the program's bytecode one at a time, so the
+// control block is the same size for a 3 interval program and an endless
+// one.
+struct control_block {
+    // Bytecode of the running program, see program.h.
+    const struct program *program;
+
+    // The current interval, decoded from the program.
+    struct interval current_interval;
+
+    // Index of the current interval within the program.
+    int current_interval_index;
+
+    // Total number intervals in the program, or PROGRAM_FOREVER.
+    int intervals_total;
+
+    // Length of the program in seconds, or PROGRAM_FOREVER.
+    int total_s;
+
+    // When the current interval started and when it ends if never paused.
+    int64_t interval_start_ms;
+    int64_t interval_end_ms;
+
+    // Time spent paused in the current interval, not counting a pause in
+    // progress.
+    int64_t interval_paused_ms;
+
+    // Part of the current interval jumped over by a seek, not time run.
+    int64_t interval_skipped_ms;
+
+    // Steps counted in the current interval, and the time they cover.
+    int32_t interval_steps;
+    int32_t interval_step_ms;
+
+    // Time spent paused in the whole program.
+    int64_t total_paused_ms;
+
+    // Is the timer paused, and since when.
+    bool is_paused;
+    int64_t pause_start_ms;
+
+    // Have we finished a program.
+    bool is_program_over;
+
+    // Called at the deadline of the current interval.
+    ControlBlockBoundaryHandler boundary_handler;
+
+    // Title of the currently selected program.
+    char *program_title;
+};
+
+// What it takes to rebuild the control block once the app was closed and
+// launched again. Timing is absolute, so time keeps running in between.
+struct control_block_state {
+    int64_t interval_start_ms;
+    int64_t pause_start_ms;
+    int32_t interval_paused_ms;
+    int32_t interval_skipped_ms;
+    int32_t total_paused_ms;
+    int32_t interval_index;
+    bool is_paused;
+};
+
+bool control_block_init(const struct program *program, char *program_title, ControlBlockBoundaryHandler boundary_handler);
+void control_block_stop();
+void control_block_log_status();
+
+void control_block_save(struct control_block_state *state);
+bool control_block_restore(const struct program *program, char *program_title, ControlBlockBoundaryHandler boundary_handler, const struct control_block_state *state);
+
+char* control_block_get_program_title();
+int control_block_get_interval_ms_left();
+int control_block_get_interval_seconds_left();
+int64_t control_block_get_deadline_ms();
+int control_block_get_interval_type();
+int control_block_get_interval_index();
+int control_block_get_intervals_total();
+int control_block_get_position_ms();
+int64_t control_block_get_time_at_ms(int position_ms);
+int control_block_get_total_s();
+int control_block_get_cadence();
+bool control_block_has_next_period();
+
+void control_block_next_period();
+void control_block_previous_period();
+void control_block_seek(int position_ms);
+void control_block_add_steps(int steps, int ms);
+
+void control_block_pause();
+void control_block_resume();
+int control_block_get_paused_ms();
+bool control_block_is_paused();
+bool control_block_is_program_over();
@@ -0,0 +1,148 @@
+#include "pebble.h"
+#include "digits.h"
+
+#define DIGIT_MIDDLE ((DIGIT_HEIGHT - DIGIT_THICKNESS) / 2)
+#define DIGITS_DOT_TOP 10
+#define DIGITS_DOT_BOTTOM 25
+
+// The sides run into the corners, so a 1 or a 7 is a full bar.
+const GRect digit_segment_rects[7] = {
+  { { DIGIT_THICKNESS, 0 }, { DIGIT_WIDTH - 2 * DIGIT_THICKNESS, DIGIT_THICKNESS } },
+  { { DIGIT_WIDTH - DIGIT_THICKNESS, 0 }, { DIGIT_THICKNESS, DIGIT_MIDDLE + DIGIT_THICKNESS } },
+  { { DIGIT_WIDTH - DIGIT_THICKNESS, DIGIT_MIDDLE }, { DIGIT_THICKNESS, DIGIT_HEIGHT - DIGIT_MIDDLE } },
+  { { DIGIT_THICKNESS, DIGIT_HEIGHT - DIGIT_THICKNESS }, { DIGIT_WIDTH - 2 * DIGIT_THICKNESS, DIGIT_THICKNESS } },
+  { { 0, DIGIT_MIDDLE }, { DIGIT_THICKNESS, DIGIT_HEIGHT - DIGIT_MIDDLE } },
+  { { 0, 0 }, { DIGIT_THICKNESS, DIGIT_MIDDLE + DIGIT_THICKNESS } },
+  { { DIGIT_THICKNESS, DIGIT_MIDDLE }, { DIGIT_WIDTH - 2 * DIGIT_THICKNESS, DIGIT_THICKNESS } },
+};
+
+const uint8_t digit_segments[10] = {
+  0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F,
+};
+
+// A digit layer's data: the digit it shows.
+static void digit_update_proc(Layer *layer, GContext *ctx){
+  uint8_t segments = digit_segments[*(uint8_t *)layer_get_data(layer)];
+
+  graphics_context_set_fill_color(ctx, GColorBlack);
+  for (int i = 0; i < 7; i++){
+    if (segments & (1 << i)){
+      graphics_fill_rect(ctx, digit_segment_rects[i], 0, GCornerNone);
+    }
+  }
+}
+
+static void colon_update_proc(Layer *layer, GContext *ctx){
+  int x = (DIGITS_COLON_WIDTH - DIGIT_THICKNESS) / 2;
+
+  graphics_context_set_fill_color(ctx, GColorBlack);
+  graphics_fill_rect(ctx, GRect(x, DIGITS_DOT_TOP, DIGIT_THICKNESS, DIGIT_THICKNESS), 0, GCornerNone);
+  graphics_fill_rect(ctx, GRect(x, DIGITS_DOT_BOTTOM, DIGIT_THICKNESS, DIGIT_THICKNESS), 0, GCornerNone);
+}
+
+// Places the digits for the current mode, centered in the frame.
+static void digits_layout(struct digits *digits){
+  GRect bounds = layer_get_bounds(digits->layer);
+  int width = digits->minutes_only ? 2 * DIGIT_WIDTH + DIGIT_GAP : DIGITS_WIDTH;
+  int x = (bounds.size.w - width) / 2;
+  int y = (bounds.size.h - DIGIT_HEIGHT) / 2;
+
+  layer_set_frame(digits->digit[0], GRect(x, y, DIGIT_WIDTH, DIGIT_HEIGHT));
+  x += DIGIT_WIDTH + DIGIT_GAP;
+  layer_set_frame(digits->digit[1], GRect(x, y, DIGIT_WIDTH, DIGIT_HEIGHT));
+  x += DIGIT_WIDTH;
+  layer_set_frame(digits->colon, GRect(x, y, DIGITS_COLON_WIDTH, DIGIT_HEIGHT));
+  x += DIGITS_COLON_WIDTH;
+  layer_set_frame(digits->digit[2], GRect(x, y, DIGIT_WIDTH, DIGIT_HEIGHT));
+  x += DIGIT_WIDTH + DIGIT_GAP;
+  layer_set_frame(digits->digit[3], GRect(x, y, DIGIT_WIDTH, DIGIT_HEIGHT));
+
+  layer_set_hidden(digits->colon, digits->minutes_only);
+  layer_set_hidden(digits->digit[2], digits->minutes_only);
+  layer_set_hidden(digits->digit[3], digits->minutes_only);
+}
+
+// Creates the layers, showing 00:00. Returns false when out of memory,
+// with nothing left allocated.
+bool digits_create(struct digits *digits, GRect frame){
+  *digits = (struct digits){
+    .layer = layer_create(frame),
+    .colon = layer_create(GRectZero),
+  };
+  for (int i = 0; i < DIGITS_COUNT; i++){
+    digits->digit[i] = layer_create_with_data(GRectZero, sizeof(uint8_t));
+  }
+
+  for (int i = 0; i < DIGITS_COUNT; i++){
+    if (!digits->digit[i]){
+      digits_destroy(digits);
+      return false;
+    }
+  }
+  if (!digits->layer || !digits->colon){
+    digits_destroy(digits);
+    return false;
+  }
+
+  for (int i = 0; i < DIGITS_COUNT; i++){
+    *(uint8_t *)layer_get_data(digits->digit[i]) = 0;
+    layer_set_update_proc(digits->digit[i], digit_update_proc);
+    layer_add_child(digits->layer, digits->digit[i]);
+  }
+  layer_set_update_proc(digits->colon, colon_update_proc);
+  layer_add_child(digits->layer, digits->colon);
+  digits_layout(digits);
+  return true;
+}
+
+void digits_destroy(struct digits *digits){
+  for (int i = 0; i < DIGITS_COUNT; i++){
+    if (digits->digit[i]){
+      layer_destroy(digits->digit[i]);
+    }
+  }
+  if (digits->colon){
+    layer_destroy(digits->colon);
+  }
+  if (digits->layer){
+    layer_destroy(digits->layer);
+  }
+  *digits = (struct digits){ .layer = NULL };
+}
+
+Layer *digits_get_layer(struct digits *digits){
+  return digits->layer;
+}
+
+void digits_set_minutes_only(struct digits *digits, bool minutes_only){
+  if (digits->layer && minutes_only != digits->minutes_only){
+    digits->minutes_only = minutes_only;
+    digits_layout(digits);
+  }
+}
+
+// Shows the time, minutes up to 99. Only the digits that changed are marked
+// dirty; seconds are left alone in minutes only mode.
+void digits_set(struct digits *digits, int minutes, int seconds){
+  uint8_t values[DIGITS_COUNT];
+  int count = digits->minutes_only ? 2 : DIGITS_COUNT;
+
+  if (!digits->layer){
+    return;
+  }
+  minutes = minutes < 0 ? 0 : minutes > 99 ? 99 : minutes;
+  seconds = seconds < 0 ? 0 : seconds > 59 ? 59 : seconds;
+  values[0] = minutes / 10;
+  values[1] = minutes % 10;
+  values[2] = seconds / 10;
+  values[3] = seconds % 10;
+
+  for (int i = 0; i < count; i++){
+    uint8_t *shown = layer_get_data(digits->digit[i]);
+
+    if (*shown != values[i]){
+      *shown = values[i];
+      layer_mark_dirty(digits->digit[i]);
+    }
+  }
+}
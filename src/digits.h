@@ -0,0 +1,45 @@
+#pragma once
+
+#include "pebble.h"
+
+// Digits: the timer's MM:SS as seven-segment digits, filled rectangles
+// from a table instead of text in a font. Every digit is a layer of its
+// own, so when a second goes by only the digits that changed are marked
+// dirty and repainted, and nothing is formatted or laid out.
+//
+// Minutes only (power mode) shows the two minute digits centered, without
+// the colon and seconds.
+//
+// Two minute digits go up to 99:59, so the packer, the phone and
+// program_prepare refuse intervals longer than that (MAX_SECONDS in
+// tools/pack_programs.py and src/sync.js, PROGRAM_MAX_SEGMENT_S in
+// program.h); the program ops themselves could hold 8191 seconds.
+#define DIGIT_WIDTH 24
+#define DIGIT_HEIGHT 40
+#define DIGIT_THICKNESS 5
+#define DIGIT_GAP 4
+#define DIGITS_COLON_WIDTH 16
+#define DIGITS_WIDTH (4 * DIGIT_WIDTH + 2 * DIGIT_GAP + DIGITS_COLON_WIDTH)
+
+// Minutes, then seconds.
+#define DIGITS_COUNT 4
+
+// Segments a to g, top, then clockwise, then the middle one, in a digit's
+// box. digit_segments has bit n set when segment n is lit.
+extern const GRect digit_segment_rects[7];
+extern const uint8_t digit_segments[10];
+
+struct digits {
+    // Centers the digits in its frame.
+    Layer *layer;
+    Layer *digit[DIGITS_COUNT];
+    Layer *colon;
+
+    bool minutes_only;
+};
+
+bool digits_create(struct digits *digits, GRect frame);
+void digits_destroy(struct digits *digits);
+Layer *digits_get_layer(struct digits *digits);
+void digits_set_minutes_only(struct digits *digits, bool minutes_only);
+void digits_set(struct digits *digits, int minutes, int seconds);
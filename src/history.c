@@ -0,0 +1,97 @@
+#include "pebble.h"
+#include "history.h"
+#include "log.h"
+
+// Size of the header at the start of every record.
+#define HISTORY_HEADER_SIZE 8
+
+// Record of the workout in progress. It is saved with the session
+// checkpoint, not here, and only written to the ring when the workout ends.
+static struct history_record history;
+
+static uint32_t history_key(uint32_t sequence){
+  return HISTORY_FIRST_KEY + sequence % HISTORY_SLOTS;
+}
+
+// Find the sequence number of the newest record. Reads the headers only.
+static bool history_newest(uint32_t *sequence){
+  struct history_record header;
+  bool found = false;
+
+  for (int slot = 0; slot < HISTORY_SLOTS; slot++){
+    if (persist_read_data(HISTORY_FIRST_KEY + slot, &header, HISTORY_HEADER_SIZE) == HISTORY_HEADER_SIZE &&
+        header.version == HISTORY_VERSION &&
+        (!found || header.sequence > *sequence)){
+      *sequence = header.sequence;
+      found = true;
+    }
+  }
+  return found;
+}
+
+// Start recording a workout.
+void history_start(int program_id){
+  memset(&history, 0, sizeof(history));
+  history.version = HISTORY_VERSION;
+  history.program_id = program_id;
+  history.start_time = (uint32_t)time(NULL);
+}
+
+// An interval was left, after active_ms not counting pauses. An interval
+// visited again adds up.
+void history_interval_ended(int interval_index, int active_ms){
+  int seconds = (active_ms + 500) / 1000;
+
+  history.active_s += seconds;
+  if (interval_index < HISTORY_MAX_INTERVALS){
+    seconds += history.durations[interval_index];
+    history.durations[interval_index] = seconds > UINT16_MAX ? UINT16_MAX : seconds;
+  }
+  if (interval_index >= history.interval_count){
+    history.interval_count = interval_index < UINT8_MAX ? interval_index + 1 : UINT8_MAX;
+  }
+}
+
+// The user moved to another interval.
+void history_skipped(){
+  if (history.skips < UINT8_MAX){
+    history.skips++;
+  }
+}
+
+// The workout is over: append its record to the ring, the oldest goes.
+void history_finish(enum history_outcome outcome, int paused_ms){
+  uint32_t sequence = 0;
+
+  if (history_newest(&sequence)){
+    sequence++;
+  }
+  history.outcome = outcome;
+  history.sequence = sequence;
+  history.paused_s = (paused_ms + 500) / 1000;
+
+  if (persist_write_data(history_key(sequence), &history, sizeof(history)) != sizeof(history)){
+    LOG_ERROR("history: cannot write record %d", (int)sequence);
+  }
+}
+
+// The record in progress, to be saved with the session.
+const struct history_record *history_current(){
+  return &history;
+}
+
+void history_restore(const struct history_record *record){
+  history = *record;
+}
+
+// Read a record, 0 being the newest. Returns false past the oldest kept.
+bool history_load(int age, struct history_record *record){
+  uint32_t newest;
+
+  if (age < 0 || age >= HISTORY_SLOTS || !history_newest(&newest) || (uint32_t)age > newest){
+    return false;
+  }
+  return persist_read_data(history_key(newest - age), record, sizeof(*record)) == sizeof(*record) &&
+         record->version == HISTORY_VERSION &&
+         record->sequence == newest - age;
+}
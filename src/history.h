@@ -0,0 +1,49 @@
+#pragma once
+
+#include "pebble.h"
+
+// Workout history: one fixed size record per workout, written once when
+// the workout ends into a ring of persist keys. Every record carries a
+// sequence number and lives in slot sequence % HISTORY_SLOTS, so the newest
+// record replaces the oldest and there is no index key to rewrite.
+#define HISTORY_FIRST_KEY 16
+#define HISTORY_SLOTS 16
+#define HISTORY_VERSION 1
+
+// Intervals whose actual duration is kept.
+#define HISTORY_MAX_INTERVALS 22
+
+enum history_outcome {
+  HISTORY_COMPLETED = 1, // Ran to the end of the program.
+  HISTORY_ABANDONED,     // Stopped with back.
+};
+
+struct history_record {
+    // Header, read alone when looking for the newest record.
+    uint8_t version;
+    uint8_t outcome;
+    uint16_t program_id;
+    uint32_t sequence;
+
+    // Start, and seconds spent in intervals and paused.
+    uint32_t start_time;
+    uint32_t active_s;
+    uint16_t paused_s;
+
+    // Presses of up and down that moved to another interval.
+    uint8_t skips;
+
+    // Intervals reached, and the seconds spent in each of the first ones.
+    uint8_t interval_count;
+    uint16_t durations[HISTORY_MAX_INTERVALS];
+};
+
+void history_start(int program_id);
+void history_interval_ended(int interval_index, int active_ms);
+void history_skipped();
+void history_finish(enum history_outcome outcome, int paused_ms);
+
+const struct history_record *history_current();
+void history_restore(const struct history_record *record);
+
+bool history_load(int age, struct history_record *record);
@@ -0,0 +1,3 @@
+#include "log.h"
+
+bool log_quiet = false;
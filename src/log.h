@@ -0,0 +1,46 @@
+#pragma once
+
+#include "pebble.h"
+
+// Compile-time log levels. Calls above LOG_LEVEL compile to nothing, format
+// string and arguments included, so release builds pay nothing for them.
+// Debug builds: ./waf configure --log-level=debug
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_WARNING
+#endif
+
+#define LOG_NOTHING(fmt, args...) do {} while (0)
+
+// Info and debug lines compiled in are also dropped at run time while this
+// is set, in low power mode, see power.h.
+extern bool log_quiet;
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(fmt, args...) APP_LOG(APP_LOG_LEVEL_ERROR, fmt, ## args)
+#else
+#define LOG_ERROR LOG_NOTHING
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARNING
+#define LOG_WARNING(fmt, args...) APP_LOG(APP_LOG_LEVEL_WARNING, fmt, ## args)
+#else
+#define LOG_WARNING LOG_NOTHING
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(fmt, args...) do { if (!log_quiet) APP_LOG(APP_LOG_LEVEL_INFO, fmt, ## args); } while (0)
+#else
+#define LOG_INFO LOG_NOTHING
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(fmt, args...) do { if (!log_quiet) APP_LOG(APP_LOG_LEVEL_DEBUG, fmt, ## args); } while (0)
+#else
+#define LOG_DEBUG LOG_NOTHING
+#endif
@@ -0,0 +1,51 @@
+#include "pebble.h"
+#include "motion.h"
+#include "cadence.h"
+
+void motion_init(struct motion *motion){
+  motion->moved = false;
+  motion->still_ms = 0;
+}
+
+// Returns true if the magnitude varies more than a still wrist's over the
+// batch. Samples shaken by the motor are left out.
+bool motion_is_moving(const AccelData *samples, uint32_t count){
+  int64_t sum = 0;
+  int64_t squares = 0;
+  int64_t n = 0;
+
+  for (uint32_t i = 0; i < count; i++){
+    int32_t magnitude;
+
+    if (samples[i].did_vibrate){
+      continue;
+    }
+    magnitude = cadence_magnitude(&samples[i]);
+    sum += magnitude;
+    squares += (int64_t)magnitude * magnitude;
+    n++;
+  }
+  if (n < 2){
+    return false;
+  }
+  return (squares - sum * sum / n) / n > MOTION_VARIANCE_THRESHOLD;
+}
+
+// Feed a batch covering the given time. Returns true once, when a wearer
+// that moved has been still for MOTION_STOP_MS.
+bool motion_stopped(struct motion *motion, const AccelData *samples, uint32_t count, int ms){
+  if (motion_is_moving(samples, count)){
+    motion->moved = true;
+    motion->still_ms = 0;
+    return false;
+  }
+  if (!motion->moved){
+    return false;
+  }
+  motion->still_ms += ms;
+  if (motion->still_ms < MOTION_STOP_MS){
+    return false;
+  }
+  motion->still_ms = 0;
+  return true;
+}
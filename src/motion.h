@@ -0,0 +1,30 @@
+#pragma once
+
+#include "pebble.h"
+
+// Motion: whether the wearer is moving, from the variance of the
+// accelerometer magnitude over each batch. A still wrist stays well under
+// the threshold, a walk well over it.
+//
+// The auto-pause uses it: once the wearer moved, MOTION_STOP_MS of still
+// batches mean they stopped. While paused the rate drops to the lowest the
+// service offers, a batch every 2.5 s, and one moving batch or a tap means
+// they are off again.
+#define MOTION_VARIANCE_THRESHOLD 2500 // mg^2
+#define MOTION_STOP_MS 3000
+
+#define MOTION_REST_SAMPLING_RATE ACCEL_SAMPLING_10HZ
+#define MOTION_REST_SAMPLING_HZ 10
+#define MOTION_REST_BATCH 25
+
+struct motion {
+    // The wearer moved since the workout started.
+    bool moved;
+
+    // Still for this long, counted in batches.
+    int32_t still_ms;
+};
+
+void motion_init(struct motion *motion);
+bool motion_is_moving(const AccelData *samples, uint32_t count);
+bool motion_stopped(struct motion *motion, const AccelData *samples, uint32_t count, int ms);
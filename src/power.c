@@ -0,0 +1,51 @@
+#include "pebble.h"
+#include "power.h"
+#include "resources.h"
+#include "buzz.h"
+#include "log.h"
+#include "trace.h"
+
+static PowerModeHandler power_handler = NULL;
+static bool low_power = false;
+
+static bool power_low_for(BatteryChargeState state){
+  return !state.is_charging && !state.is_plugged && state.charge_percent <= LOW_POWER_PERCENT;
+}
+
+static void power_set(bool low){
+  low_power = low;
+  buzz_set_low_power(low);
+  log_quiet = low;
+  trace(TRACE_LOW_POWER, low);
+}
+
+static void battery_handler(BatteryChargeState state){
+  bool low = power_low_for(state);
+
+  if (low == low_power){
+    return;
+  }
+  LOG_WARNING("low power %d, battery %d%%", low, state.charge_percent);
+  power_set(low);
+  if (power_handler){
+    power_handler(low);
+  }
+}
+
+void power_init(PowerModeHandler handler){
+  power_handler = handler;
+  low_power = false;
+  if (power_low_for(battery_state_service_peek())){
+    power_set(true);
+  }
+  battery_state_service_subscribe(battery_handler);
+}
+
+void power_deinit(){
+  battery_state_service_unsubscribe();
+  power_handler = NULL;
+}
+
+bool power_is_low(){
+  return low_power;
+}
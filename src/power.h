@@ -0,0 +1,18 @@
+#pragma once
+
+#include "pebble.h"
+
+// Low power mode: once the battery is down to LOW_POWER_PERCENT and the
+// watch is not charging, the workout is coached with as little as the
+// battery can spare. The timer only wakes up for boundaries and reminders,
+// the seconds are not counted down unless a button is pressed, info and
+// debug logging is off and every vibration is shorter. Plugging the watch
+// in brings the full mode back.
+
+// Called when the mode switches, not for the mode power_init starts in.
+typedef void (*PowerModeHandler)(bool low_power);
+
+void power_init(PowerModeHandler handler);
+void power_deinit();
+
+bool power_is_low();
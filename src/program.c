@@ -0,0 +1,200 @@
+#include "pebble.h"
+#include "program.h"
+#include "resources.h"
+
+static void program_decode(uint16_t word, struct interval *interval){
+  interval->type = PROGRAM_OP(word);
+  interval->duration = PROGRAM_ARG(word);
+}
+
+// Start a block at the given op, after the intervals and seconds so far.
+static struct program_block *program_open_block(struct program *program, int first_op, int times, int64_t intervals, int64_t seconds){
+  struct program_block *block;
+
+  if (program->block_count == PROGRAM_MAX_BLOCKS){
+    return NULL;
+  }
+  block = &program->blocks[program->block_count++];
+  block->first_op = (uint8_t)first_op;
+  block->length = 0;
+  block->times = (uint16_t)times;
+  block->first_interval = (int32_t)intervals;
+  block->start_s = (int32_t)seconds;
+  block->pass_s = 0;
+  return block;
+}
+
+// Add a finished block to the intervals and seconds so far. An empty repeat
+// plays nothing and is dropped.
+static void program_close_block(struct program *program, const struct program_block *block, int64_t *intervals, int64_t *seconds){
+  if (!block){
+    return;
+  }
+  if (block->length == 0){
+    program->block_count--;
+    return;
+  }
+  *intervals += (int64_t)block->times * block->length;
+  *seconds += (int64_t)block->times * block->pass_s;
+}
+
+// Build the prefix sums of a program whose ops were just loaded. Returns
+// false if the ops are not a program: an unknown opcode, a segment of no
+// seconds or longer than the timer shows, a REPEAT nested or left open, an
+// END without one, anything after a repeat that never ends, or more
+// intervals or seconds than we count. The packer and sync.js refuse all of
+// these, but a catalog synced from the phone is only checked for transfer
+// errors.
+bool program_prepare(struct program *program){
+  struct program_block *block = NULL;
+  bool in_repeat = false;
+  bool forever = false;
+  int64_t intervals = 0;
+  int64_t seconds = 0;
+
+  program->block_count = 0;
+
+  for (int pc = 0; pc < program->op_count; pc++){
+    uint16_t word = program->ops[pc];
+
+    if (forever){
+      return false;
+    }
+
+    if (PROGRAM_OP(word) == PROGRAM_OP_REPEAT){
+      if (in_repeat){
+        return false;
+      }
+      program_close_block(program, block, &intervals, &seconds);
+      block = program_open_block(program, pc + 1, PROGRAM_ARG(word), intervals, seconds);
+      in_repeat = true;
+    } else if (PROGRAM_OP(word) == PROGRAM_OP_END){
+      if (!in_repeat){
+        return false;
+      }
+      forever = block->times == 0 && block->length > 0;
+      program_close_block(program, block, &intervals, &seconds);
+      block = NULL;
+      in_repeat = false;
+    } else {
+      // The type indexes the names and vibes of the intervals.
+      if (PROGRAM_OP(word) > INTERVAL_TYPE_COOLDOWN){
+        return false;
+      }
+
+      // Boundaries of a segment of no seconds all fall at the same instant,
+      // for ever in a repeat that never ends; a longer one than the digits
+      // show would count down from 99:59 for a while.
+      if (PROGRAM_ARG(word) == 0 || PROGRAM_ARG(word) > PROGRAM_MAX_SEGMENT_S){
+        return false;
+      }
+
+      // Segments outside a repeat make a block of one pass.
+      if (!block){
+        block = program_open_block(program, pc, 1, intervals, seconds);
+      }
+      if (!block){
+        return false;
+      }
+      program->pass_start_s[pc] = block->pass_s;
+      block->pass_s += PROGRAM_ARG(word);
+      block->length++;
+    }
+  }
+
+  if (in_repeat){
+    return false;
+  }
+  program_close_block(program, block, &intervals, &seconds);
+  if (intervals > INT32_MAX || seconds > INT32_MAX){
+    return false;
+  }
+
+  program->interval_count = forever ? PROGRAM_FOREVER : (int32_t)intervals;
+  program->total_s = forever ? PROGRAM_FOREVER : (int32_t)seconds;
+  return true;
+}
+
+// Number of intervals the program expands to, or PROGRAM_FOREVER.
+int program_interval_count(const struct program *program){
+  return program->interval_count;
+}
+
+// Number of seconds the program lasts, or PROGRAM_FOREVER.
+int program_total_s(const struct program *program){
+  return program->total_s;
+}
+
+// Last block starting at or before the given interval index, or second.
+// The program must have a block.
+static const struct program_block *program_find_block(const struct program *program, int key, bool by_second){
+  int low = 0;
+  int high = program->block_count - 1;
+
+  while (low < high){
+    int middle = (low + high + 1) / 2;
+    const struct program_block *block = &program->blocks[middle];
+
+    if ((by_second ? block->start_s : block->first_interval) <= key){
+      low = middle;
+    } else {
+      high = middle - 1;
+    }
+  }
+  return &program->blocks[low];
+}
+
+// Decode the interval at the given index of the expanded program. A binary
+// search over the blocks, so it costs about the same at any index.
+bool program_interval_at(const struct program *program, int index, struct interval *interval){
+  const struct program_block *block;
+  int pass;
+  int pc;
+
+  if (index < 0 || (program->interval_count != PROGRAM_FOREVER && index >= program->interval_count)){
+    return false;
+  }
+
+  block = program_find_block(program, index, false);
+  index -= block->first_interval;
+  pass = index / block->length;
+  pc = block->first_op + index % block->length;
+
+  program_decode(program->ops[pc], interval);
+  interval->start_s = block->start_s + pass * block->pass_s + program->pass_start_s[pc];
+  return true;
+}
+
+// Find the interval playing at the given second of the program. Returns
+// false before the start and past the end.
+bool program_seek(const struct program *program, int second, int *index, struct interval *interval){
+  const struct program_block *block;
+  int pass;
+  int low;
+  int high;
+
+  if (second < 0 || (program->total_s != PROGRAM_FOREVER && second >= program->total_s)){
+    return false;
+  }
+
+  block = program_find_block(program, second, true);
+  second -= block->start_s;
+  pass = block->pass_s > 0 ? second / block->pass_s : 0;
+  second -= pass * block->pass_s;
+
+  // Last segment of the pass starting at or before that second.
+  low = block->first_op;
+  high = block->first_op + block->length - 1;
+  while (low < high){
+    int middle = (low + high + 1) / 2;
+
+    if (program->pass_start_s[middle] <= second){
+      low = middle;
+    } else {
+      high = middle - 1;
+    }
+  }
+
+  *index = block->first_interval + pass * block->length + (low - block->first_op);
+  return program_interval_at(program, *index, interval);
+}
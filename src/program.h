@@ -0,0 +1,78 @@
+#pragma once
+
+#include "pebble.h"
+#include "control_block.h"
+
+// Workout bytecode. A program is a short list of 16-bit ops, the opcode in
+// the top 3 bits and its argument below:
+//
+//   0-4  SEGMENT  one interval; the opcode is the INTERVAL_TYPE_*, the
+//                 argument its duration in seconds
+//   5    REPEAT   repeat the ops up to the matching END argument times,
+//                 0 repeats forever
+//   6    END      closes a REPEAT
+//
+// "Warmup, 5 x (run 90, walk 120), cooldown" is 5 ops however many
+// intervals it expands to. Repeats do not nest. The interpreter keeps no
+// state besides the interval index, so memory stays constant whatever the
+// program length.
+//
+// When a program is loaded, program_prepare splits it into blocks, a REPEAT
+// or a run of segments outside any, and sums up the intervals and seconds
+// before each block and each segment. The interval at any index or at any
+// second of the program is then found by binary search, without walking
+// the ops.
+#define PROGRAM_MAX_OPS 64
+
+// A block takes at least one op, and no two runs of segments are next to
+// each other.
+#define PROGRAM_MAX_BLOCKS (PROGRAM_MAX_OPS / 2 + 1)
+
+#define PROGRAM_ARG_BITS 13
+#define PROGRAM_OP(word) ((word) >> PROGRAM_ARG_BITS)
+#define PROGRAM_ARG(word) ((word) & ((1 << PROGRAM_ARG_BITS) - 1))
+
+#define PROGRAM_OP_REPEAT 5
+#define PROGRAM_OP_END 6
+
+// Longest segment, 99:59 on the timer's two minute digits (see digits.h),
+// though the argument could hold 8191 seconds.
+#define PROGRAM_MAX_SEGMENT_S (99 * 60 + 59)
+
+// Interval count of a program that repeats forever.
+#define PROGRAM_FOREVER -1
+
+struct program_block {
+    // Segments of one pass, ops[first_op] onwards.
+    uint8_t first_op;
+    uint8_t length;
+
+    // Passes, 0 for ever. A run of segments makes one.
+    uint16_t times;
+
+    // Intervals and seconds before the block, and the seconds of a pass.
+    int32_t first_interval;
+    int32_t start_s;
+    int32_t pass_s;
+};
+
+struct program {
+    uint16_t op_count;
+    uint16_t ops[PROGRAM_MAX_OPS];
+
+    // Prefix sums, filled in by program_prepare. For every segment, the
+    // seconds before it in the pass of its block.
+    uint8_t block_count;
+    struct program_block blocks[PROGRAM_MAX_BLOCKS];
+    int32_t pass_start_s[PROGRAM_MAX_OPS];
+
+    // Intervals and seconds of the whole program, or PROGRAM_FOREVER.
+    int32_t interval_count;
+    int32_t total_s;
+};
+
+bool program_prepare(struct program *program);
+int program_interval_count(const struct program *program);
+int program_total_s(const struct program *program);
+bool program_interval_at(const struct program *program, int index, struct interval *interval);
+bool program_seek(const struct program *program, int second, int *index, struct interval *interval);
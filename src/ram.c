@@ -0,0 +1,31 @@
+#include "pebble.h"
+#include "ram.h"
+#include "log.h"
+
+static size_t peak_used = 0;
+static size_t least_free = SIZE_MAX;
+
+// Note the heap at the given point.
+void ram_note(const char *where){
+  size_t used = heap_bytes_used();
+  size_t available = heap_bytes_free();
+
+  if (used > peak_used){
+    peak_used = used;
+  }
+  if (available < least_free){
+    least_free = available;
+  }
+  LOG_INFO("ram: %s, heap %u used, %u free, at most %u used, at least %u free",
+           where, (unsigned)used, (unsigned)available, (unsigned)peak_used, (unsigned)least_free);
+}
+
+// Most heap in use at any noted point since launch.
+size_t ram_peak_used(){
+  return peak_used;
+}
+
+// Least heap free at any noted point since launch.
+size_t ram_least_free(){
+  return least_free;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "pebble.h"
+
+// RAM watch: where the heap stands at the points that move it most, every
+// window load and unload and every session start. The most used and the
+// least free since launch are kept, and logged with the current numbers at
+// info level (./waf configure --log-level=info).
+void ram_note(const char *where);
+size_t ram_peak_used();
+size_t ram_least_free();
@@ -0,0 +1,158 @@
+#include "pebble.h"
+#include "reminders.h"
+#include "control_block.h"
+#include "program.h"
+#include "scheduler.h"
+#include "buzz.h"
+#include "log.h"
+#include "trace.h"
+
+// A pattern per slot, none like the pulses of boundaries.
+static const uint32_t reminder_pattern_0[] = { 150, 150, 150 };
+static const uint32_t reminder_pattern_1[] = { 150, 150, 150, 150, 150 };
+static const uint32_t reminder_pattern_2[] = { 400, 150, 150 };
+static const uint32_t reminder_pattern_3[] = { 150, 150, 400 };
+
+static const VibePattern reminder_patterns[REMINDERS_MAX] = {
+  { reminder_pattern_0, sizeof(reminder_pattern_0) / sizeof(uint32_t) },
+  { reminder_pattern_1, sizeof(reminder_pattern_1) / sizeof(uint32_t) },
+  { reminder_pattern_2, sizeof(reminder_pattern_2) / sizeof(uint32_t) },
+  { reminder_pattern_3, sizeof(reminder_pattern_3) / sizeof(uint32_t) },
+};
+
+// Reminders of the running workout, or the ones turned on while the menus
+// are up. The scheduler knows a reminder's event by its slot.
+static struct reminder reminders[REMINDERS_MAX];
+
+static void reminder_buzz(int slot){
+  buzz_pattern(reminder_patterns[slot].durations, reminder_patterns[slot].num_segments);
+}
+
+// Point of the program of every slot's last buzz, 0 for none: nothing
+// goes off at the start.
+static int buzzed_ms[REMINDERS_MAX];
+
+// Next time the reminder in the slot goes off, -1 if not before the
+// program ends. A reminder due now is due until it went off, also when
+// posted again by another event of the same wakeup.
+static int64_t reminder_next_ms(int slot){
+  int period_ms = reminders[slot].period_s * 1000;
+  int total_s = control_block_get_total_s();
+  int next_ms = (control_block_get_position_ms() + period_ms - 1) / period_ms * period_ms;
+
+  if (next_ms == 0 || next_ms == buzzed_ms[slot]){
+    next_ms += period_ms;
+  }
+  if (total_s != PROGRAM_FOREVER && next_ms >= total_s * 1000){
+    return -1;
+  }
+  return control_block_get_time_at_ms(next_ms);
+}
+
+static void reminder_callback(void *data);
+
+static void reminder_post(int slot){
+  int64_t at_ms = reminders[slot].period_s ? reminder_next_ms(slot) : -1;
+
+  if (at_ms < 0){
+    scheduler_cancel(reminder_callback, &reminders[slot]);
+    return;
+  }
+  scheduler_post(at_ms, reminder_callback, &reminders[slot]);
+}
+
+// A reminder is due: buzz and post the next one.
+static void reminder_callback(void *data){
+  int slot = (struct reminder *)data - reminders;
+  int period_ms = reminders[slot].period_s * 1000;
+
+  buzzed_ms[slot] = control_block_get_position_ms() / period_ms * period_ms;
+  reminder_buzz(slot);
+  trace(TRACE_REMINDER, slot);
+  reminder_post(slot);
+}
+
+// Read the reminders turned on, for the menus and the next workout.
+void reminders_load(){
+  if (persist_read_data(REMINDERS_PERSIST_KEY, reminders, sizeof(reminders)) != sizeof(reminders)){
+    memset(reminders, 0, sizeof(reminders));
+  }
+}
+
+// Slot of the reminder of a program, or a free slot for program -1.
+static int reminder_find(int program_id){
+  for (int slot = 0; slot < REMINDERS_MAX; slot++){
+    if (program_id < 0 ? !reminders[slot].period_s :
+        reminders[slot].period_s && reminders[slot].program_id == program_id){
+      return slot;
+    }
+  }
+  return -1;
+}
+
+// Turn the reminder of a program on or off, for the workouts to come.
+// Returns true if it is on. A reminder turned on buzzes once, so that the
+// wearer knows its pattern.
+bool reminders_toggle(int program_id, int period_s){
+  int slot = reminder_find(program_id);
+
+  if (slot >= 0){
+    reminders[slot].period_s = 0;
+  } else if (period_s > 0 && (slot = reminder_find(-1)) >= 0){
+    reminders[slot] = (struct reminder){ .program_id = program_id, .period_s = period_s };
+    reminder_buzz(slot);
+  } else {
+    LOG_WARNING("reminders: no room for another");
+    return false;
+  }
+
+  if (persist_write_data(REMINDERS_PERSIST_KEY, reminders, sizeof(reminders)) < 0){
+    LOG_ERROR("reminders: cannot save");
+  }
+  return reminders[slot].period_s != 0;
+}
+
+// Is the reminder of a program on.
+bool reminders_is_on(int program_id){
+  return reminder_find(program_id) >= 0;
+}
+
+// The reminders of a workout, saved with its session.
+void reminders_save(struct reminder *saved){
+  memcpy(saved, reminders, sizeof(reminders));
+}
+
+void reminders_restore(const struct reminder *saved){
+  memcpy(reminders, saved, sizeof(reminders));
+}
+
+// Post the reminders for the control block, again whenever its timing
+// changed: a start, a boundary, a skip, a scrub, a resume. Posting an event
+// again only moves it.
+void reminders_arm(){
+  for (int slot = 0; slot < REMINDERS_MAX; slot++){
+    reminder_post(slot);
+  }
+}
+
+// The workout is paused or over, nothing goes off.
+void reminders_stop(){
+  for (int slot = 0; slot < REMINDERS_MAX; slot++){
+    scheduler_cancel(reminder_callback, &reminders[slot]);
+    buzzed_ms[slot] = 0;
+  }
+}
+
+// When the next reminder of the running workout goes off, -1 if none will.
+int64_t reminders_next_ms(){
+  int64_t next = -1;
+
+  for (int slot = 0; slot < REMINDERS_MAX; slot++){
+    int64_t at_ms = reminders[slot].period_s ? reminder_next_ms(slot) : -1;
+
+    if (at_ms >= 0 && (next < 0 || at_ms < next)){
+      next = at_ms;
+    }
+  }
+  return next;
+}
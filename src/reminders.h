@@ -0,0 +1,39 @@
+#pragma once
+
+#include "pebble.h"
+
+// Persist keys.
+#define REMINDERS_PERSIST_KEY 2
+
+// Reminders: periodic buzzes alongside any workout, a drink every ten
+// minutes of a long run say. Any program of periodic intervals can be one:
+// a long press on it in its menu turns it on or off for the workouts to
+// come, and every reminder buzzes a pattern of its own. A workout keeps the
+// reminders it was started with, they are saved with its session.
+//
+// A reminder goes off at every multiple of its period into the program,
+// counted like the program's own time: it stops while paused and follows
+// skips and scrubs. Each is an event of its own on the scheduler, on the
+// whole seconds of the program like boundaries and redraws, so reminders
+// due in the same second as each other or as a boundary are run by the
+// same wakeup, and buzz.h makes one vibration of them.
+#define REMINDERS_MAX 4
+
+struct reminder {
+    // Catalog program it was taken from.
+    uint16_t program_id;
+
+    // Seconds between two buzzes, 0 for a free slot.
+    uint16_t period_s;
+};
+
+void reminders_load();
+bool reminders_toggle(int program_id, int period_s);
+bool reminders_is_on(int program_id);
+
+void reminders_save(struct reminder *reminders);
+void reminders_restore(const struct reminder *reminders);
+
+void reminders_arm();
+void reminders_stop();
+int64_t reminders_next_ms();
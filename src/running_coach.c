@@ -1,483 +1,994 @@
 #include "pebble.h"
 #include "resources.h"
+#include "control_block.h"
+#include "catalog.h"
+#include "session.h"
+#include "sync.h"
+#include "history.h"
+#include "scheduler.h"
+#include "cadence.h"
+#include "motion.h"
+#include "digits.h"
+#include "buzz.h"
+#include "reminders.h"
+#include "power.h"
+#include "ram.h"
+#include "log.h"
+#include "trace.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 /*                                UI VARIABLES                               */
 ///////////////////////////////////////////////////////////////////////////////
-// Windows.  
-static Window *main_window; // Main.
-static Window *program_window; // Training program.
-static Window *timer_window; // Timer.
-
-// Three lines of text for the timer window.
-static TextLayer *tw_tl_time; // Time.
+// Windows, created when pushed and destroyed when popped, NULL while off
+// the stack.
+static Window *main_window = NULL; // Main.
+static Window *program_window = NULL; // Training program.
+static Window *timer_window = NULL; // Timer.
+
+// Time left in the interval, then three lines of text for the timer window.
+static struct digits tw_digits; // Time.
 static TextLayer *tw_tl_type; // Type of period.
 static TextLayer *tw_tl_interval; // Period count.
+static TextLayer *tw_tl_total; // Whole program.
+
+// Stores string for the timer screen. The period formats hold two ints of
+// up to 11 characters each.
+char interval_value[40];
+char total_value[40];
+
+// What the timer window currently shows, so that draw_timer only sets and
+// invalidates the layers whose content changed. Most seconds only the time
+// moves; type and period change at boundaries. -1 means unknown.
+static struct {
+  int time; // Seconds left, or minutes left in power mode.
+  bool power_save;
+  bool time_hidden; // Low power mode hides the time.
+  bool low_power;
+  int type;
+  int index;
+  bool paused;
+  int total; // Minutes left in the program.
+  int percent;
+  int cadence; // Steps per minute in the interval, -1 not yet known, -2 unknown here.
+} shown;
+
+// Redraw resolution of the timer window, 0 when nothing moves. Redraws,
+// like every other timed event, are posted to the scheduler.
+static TimeUnits tick_units = 0;
+
+// Power mode: minute redraws while the interval is long, see
+// update_tick_mode.
+static bool power_save = false;
+static bool peeking = false;
+
+// What the accelerometer does: nothing, count steps and watch for a stop
+// while the workout runs on screen, or rest at the lowest rate while it is
+// auto-paused, waiting for the wearer to move. The interval's cadence shows
+// with the next redraw, batches do not redraw.
+enum accel_mode {
+  ACCEL_OFF,
+  ACCEL_COUNTING,
+  ACCEL_RESTING,
+};
+
+static enum accel_mode accel_mode = ACCEL_OFF;
+static struct cadence cadence;
+static struct motion motion;
+
+// The workout was paused because the wearer stopped, not with select.
+static bool auto_paused = false;
+
+// A workout is running and carries on in the background if the app closes.
+static bool workout_live = false;
+
+// Catalog record of the program menu currently visible, allocated with its
+// window. Rows are read from the catalog as they are drawn, see catalog.h.
+static struct catalog_menu *selected_program_menu = NULL;
+
+// Main menu row and catalog program number of the workout, saved with the
+// session.
+static int selected_menu_index;
+static int selected_program_id;
+static uint32_t selected_program_hash;
+
+// Program being run, its bytecode is only loaded when it starts.
+static struct catalog_program selected_program;
+static struct program program_code;
 
-// Stores string for the timer screen.
-char interval_value[20];
-char timer_value[10];
+// Menu layers.
+static MenuLayer *main_menu_layer;
+static MenuLayer *program_menu_layer;
 
-// Program menu currently visible.
-static struct menu_item *selected_program_menu;
+///////////////////////////////////////////////////////////////////////////////
+/*                              UTILITY FUNCTIONS                            */
+///////////////////////////////////////////////////////////////////////////////
+// Draws a menu row from the label of its catalog record.
+static void draw_menu_row(GContext *ctx, const Layer *cell_layer, const struct catalog_label *label){
+  menu_cell_basic_draw(ctx, cell_layer, label->title, label->subtitle, NULL);
+}
 
-// Menu layers.
-static SimpleMenuLayer *main_menu_layer;
-static SimpleMenuLayer *program_menu_layer;
 
-// A simple menu layer can have multiple sections.
-static SimpleMenuSection main_menu_sections[1];
-static SimpleMenuSection program_menu_sections[1];
+// Forget what the timer window shows, the next draw_timer sets everything.
+static void forget_shown(){
+  shown.time = -1;
+  shown.time_hidden = false;
+  shown.type = -1;
+  shown.index = -1;
+  shown.paused = false;
+  shown.total = -1;
+  shown.percent = -1;
+  shown.cadence = -2;
+}
 
-// Main menu: shows C25K and B210K options.
-static SimpleMenuItem main_menu_items[MAX_MENU_ITEMS];
-static SimpleMenuItem program_menu_items[MAX_MENU_ITEMS];
+// Period line: which interval this is, and in low power mode, or that the
+// workout is paused.
+static void draw_period(){
+  if (shown.paused){
+    text_layer_set_text(tw_tl_interval, MESSAGE_PAUSED);
+    layer_mark_dirty((Layer *)tw_tl_interval);
+    return;
+  }
+  if (shown.low_power){
+    if (control_block_get_intervals_total() == PROGRAM_FOREVER){
+      snprintf(interval_value, sizeof(interval_value), MESSAGE_PERIOD_FOREVER_LOW_POWER, control_block_get_interval_index() + 1);
+    } else {
+      snprintf(interval_value, sizeof(interval_value), MESSAGE_PERIOD_LOW_POWER, control_block_get_interval_index() + 1, control_block_get_intervals_total());
+    }
+  } else if (control_block_get_intervals_total() == PROGRAM_FOREVER){
+    snprintf(interval_value, sizeof(interval_value), MESSAGE_PERIOD_FOREVER, control_block_get_interval_index() + 1);
+  } else {
+    snprintf(interval_value, sizeof(interval_value), MESSAGE_PERIOD, control_block_get_interval_index() + 1, control_block_get_intervals_total());
+  }
+  text_layer_set_text(tw_tl_interval, interval_value); 
+  layer_mark_dirty((Layer *)tw_tl_interval);
+}
 
-///////////////////////////////////////////////////////////////////////////////
-/*                                GLOBALS                                    */
-///////////////////////////////////////////////////////////////////////////////
-bool timer_paused = false; // Is timer paused?
+static void draw_timer(){
+  // Get seconds and minutes.  
+  int seconds_left = control_block_get_interval_seconds_left();
+  int m = seconds_left / 60;
+  int s = seconds_left - (m * 60);
+  int time = power_save ? (seconds_left + 59) / 60 : seconds_left;
+  int total_s = control_block_get_total_s();
+  int cadence_now = control_block_get_cadence();
+  bool hide_time = power_is_low() && !peeking;
+
+  // Low power mode shows no time unless the user peeks: nothing would
+  // count it down.
+  if (!control_block_is_program_over() && hide_time != shown.time_hidden){
+    layer_set_hidden(digits_get_layer(&tw_digits), hide_time);
+    shown.time_hidden = hide_time;
+  }
 
-// Control block is a structure that keeps track of all variables related to
-// the operation of the timer screen. There is a set of functions that is
-// used to abstract apps interaction with it and encapsulate the logic.
-struct control_block cb = {.loop_first = false}; // Empty control block.
+  // Update timer, minutes only (rounded up) in power mode. Only the digits
+  // that changed are repainted.
+  if (!hide_time && (time != shown.time || power_save != shown.power_save)){
+    digits_set_minutes_only(&tw_digits, power_save);
+    digits_set(&tw_digits, power_save ? time : m, s);
+    shown.time = time;
+    shown.power_save = power_save;
+  }
 
-///////////////////////////////////////////////////////////////////////////////
-/*                          FUNCTION DECLARATIONS                            */
-///////////////////////////////////////////////////////////////////////////////
-static void handle_tick(struct tm *tick_time, TimeUnits units_changed);
+  // Update the whole program, minutes left rounded up and percent done,
+  // and the cadence of the interval once it is known. Programs that repeat
+  // forever have no end to count to.
+  if (total_s != PROGRAM_FOREVER && total_s > 0){
+    int position_ms = control_block_get_position_ms();
+    int total = (total_s * 1000 - position_ms + 59999) / 60000;
+    int percent = (int)((int64_t)position_ms * 100 / ((int64_t)total_s * 1000));
+
+    if (total != shown.total || percent != shown.percent || cadence_now != shown.cadence){
+      if (cadence_now >= 0){
+        snprintf(total_value, sizeof(total_value), MESSAGE_TOTAL_CADENCE, total, percent, cadence_now);
+      } else {
+        snprintf(total_value, sizeof(total_value), MESSAGE_TOTAL, total, percent);
+      }
+      text_layer_set_text(tw_tl_total, total_value);
+      layer_mark_dirty((Layer *)tw_tl_total);
+      shown.total = total;
+      shown.percent = percent;
+      shown.cadence = cadence_now;
+    }
+  } else if (cadence_now != shown.cadence){
+    if (cadence_now >= 0){
+      snprintf(total_value, sizeof(total_value), MESSAGE_CADENCE, cadence_now);
+    } else {
+      total_value[0] = '\0';
+    }
+    text_layer_set_text(tw_tl_total, total_value);
+    layer_mark_dirty((Layer *)tw_tl_total);
+    shown.cadence = cadence_now;
+  }
 
-///////////////////////////////////////////////////////////////////////////////
-/*                            CONTROL BLOCK MANAGEMENT                       */
-///////////////////////////////////////////////////////////////////////////////
+  // Within an interval only a pause or the power mode changes the period
+  // line, so that a press on select shows at once.
+  if (control_block_get_interval_type() == shown.type &&
+      control_block_get_interval_index() == shown.index){
+    if (control_block_is_paused() != shown.paused || power_is_low() != shown.low_power){
+      shown.paused = control_block_is_paused();
+      shown.low_power = power_is_low();
+      draw_period();
+    }
+    return;
+  }
+  shown.type = control_block_get_interval_type();
+  shown.index = control_block_get_interval_index();
+  shown.paused = control_block_is_paused();
+  shown.low_power = power_is_low();
 
-// Initialize control block.
-static void control_block_init(struct interval *current_interval, char *program_title, int intervals_total, bool loop_first){
-  cb.current_interval = current_interval;
-  cb.program_title = program_title;
-  cb.current_interval_index = 0;
-  cb.current_interval_seconds_left = cb.current_interval->duration;
-  cb.loop_first = loop_first;
-
-  // If we loop the first interval (for intervals mode), we make
-  // the total number of itervals to be a 100.
-  if (!loop_first){
-    cb.intervals_total = intervals_total;
-    cb.intervals_left = intervals_total;
+  // Update type.
+  if (control_block_get_interval_type() == INTERVAL_TYPE_RUN){
+    text_layer_set_text(tw_tl_type, MESSAGE_RUN); 
+  } else if (control_block_get_interval_type() == INTERVAL_TYPE_WALK) {
+    text_layer_set_text(tw_tl_type, MESSAGE_WALK); 
+  } else if (control_block_get_interval_type() == INTERVAL_TYPE_WARMUP) {
+    text_layer_set_text(tw_tl_type, MESSAGE_WARMUP);
+  } else if (control_block_get_interval_type() == INTERVAL_TYPE_COOLDOWN) {
+    text_layer_set_text(tw_tl_type, MESSAGE_COOLDOWN);
   } else {
-    cb.intervals_total = 100;
-    cb.intervals_left = 100;
+    text_layer_set_text(tw_tl_type, control_block_get_program_title()); 
   }
-
-  cb.is_interval_over = false;
-  cb.is_program_over = false;
+  layer_mark_dirty((Layer *)tw_tl_type);
+  draw_period();
 }
 
-// Prints the status of the control block.
-static void control_block_log_status(){
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "======================== CB STR ========================");
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "Intervals: \tTotal\tCurrent\tLeft");
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "\t\t%d\t%d\t%d", cb.intervals_total, cb.current_interval_index, cb.intervals_left);
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "Seconds left: %d", cb.current_interval_seconds_left);
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "Is first interval looped: %d", cb.loop_first);
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "Is interval over: %d", cb.is_interval_over);
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "Is program over: %d", cb.is_interval_over);
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "======================== CB END ========================");
-}
+static void schedule_redraw();
 
-// Get Program's Title.
-static char* control_block_get_program_title(){
-  return cb.program_title;
+// Redraws the timer when the time shown changes.
+static void redraw_callback(void *data){
+  draw_timer();
+  schedule_redraw();
 }
 
-// Get number of seconds left in the current interval.
-static int control_block_get_interval_seconds_left(){
-  return cb.current_interval_seconds_left;
-}
+// Post the next redraw for the moment the time shown changes: the next
+// whole second left, or whole minute in power mode, counted back from the
+// deadline so it never drifts. The boundary redraws on its own.
+static void schedule_redraw(){
+  int unit_ms = tick_units == MINUTE_UNIT ? 60 * 1000 : 1000;
+  int ms_left = control_block_get_interval_ms_left();
 
-// Get type of the interval (walk, run).
-static int control_block_get_interval_type(){
-  return cb.current_interval -> type;
+  if (ms_left <= 0){
+    scheduler_cancel(redraw_callback, NULL);
+    return;
+  }
+  scheduler_post(control_block_get_deadline_ms() - (ms_left - 1) / unit_ms * unit_ms, redraw_callback, NULL);
 }
 
-// Get the number of intervals legft in the program.
-static int control_block_get_intervals_left(){
-  return cb.intervals_left;
+// Redraw at the given resolution, 0 to stop.
+static void set_tick_units(TimeUnits units){
+  if (units != tick_units){
+    tick_units = units;
+    trace(TRACE_TICK_MODE, units);
+  }
+  if (units){
+    schedule_redraw();
+  } else {
+    scheduler_cancel(redraw_callback, NULL);
+  }
 }
 
-// Get the total number of intervals in the program.
-static int control_block_get_intervals_total(){
-  return cb.intervals_total;
-}
+static void auto_pause();
+static void auto_resume();
 
-// Advance to the next period.
-static void control_block_next_period(){
-  if (cb.intervals_left > 1){
+// Resting, one moving batch resumes. Otherwise the batch is counted into
+// the interval, and a stop pauses it; periodic timers are not workouts and
+// never pause on their own.
+static void accel_handler(AccelData *data, uint32_t num_samples){
+  int ms = num_samples * 1000 / CADENCE_SAMPLING_HZ;
 
-    cb.intervals_left--;
-    
-    // If we are looping through the first
-    // interval in the program, we don't need
-    // to advance to the next interval in
-    // the structure.
-    if (!cb.loop_first){
-      cb.current_interval++;
+  if (accel_mode == ACCEL_RESTING){
+    if (motion_is_moving(data, num_samples)){
+      auto_resume();
     }
+    return;
+  }
 
-    cb.current_interval_index++;
-
-    // Adding one second because timer_callback starts by subtracting one.
-    cb.current_interval_seconds_left = cb.current_interval->duration + 1;
+  control_block_add_steps(cadence_process(&cadence, data, num_samples), ms);
+  if (motion_stopped(&motion, data, num_samples, ms) &&
+      control_block_get_interval_type() != INTERVAL_TYPE_PERIODIC){
+    auto_pause();
   }
 }
 
-// Go back to the previos period.
-static void control_block_previous_period(){
-  if (cb.intervals_left < cb.intervals_total){
-    cb.intervals_left++;
-    
-    // If we are looping through the first
-    // interval in the program, we don't need
-    // to go back to the previous interval in
-    // the structure.
-    if (!cb.loop_first){
-      cb.current_interval--;
-    }
-    cb.current_interval_index--;
-  } 
+static void tap_handler(AccelAxisType axis, int32_t direction){
+  auto_resume();
+}
+
+// Switch the accelerometer to the given mode. The step detector starts
+// over when counting starts again, what it held is from before the pause.
+static void set_accel_mode(enum accel_mode mode){
+  if (mode == accel_mode){
+    return;
+  }
+  if (accel_mode == ACCEL_RESTING){
+    accel_tap_service_unsubscribe();
+  }
+  if (accel_mode != ACCEL_OFF){
+    accel_data_service_unsubscribe();
+  }
 
-  // Adding one second because timer_callback starts by subtracting one.
-  cb.current_interval_seconds_left = cb.current_interval->duration + 1;
+  accel_mode = mode;
+  if (mode == ACCEL_COUNTING){
+    cadence_init(&cadence);
+    motion.still_ms = 0;
+    accel_data_service_subscribe(CADENCE_BATCH, accel_handler);
+    accel_service_set_sampling_rate(CADENCE_SAMPLING_RATE);
+  } else if (mode == ACCEL_RESTING){
+    accel_data_service_subscribe(MOTION_REST_BATCH, accel_handler);
+    accel_service_set_sampling_rate(MOTION_REST_SAMPLING_RATE);
+    accel_tap_service_subscribe(tap_handler);
+  }
 }
 
-// Updated the control block to handle a "tick".
-static void control_block_tick(){
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "Timer ticked, control state BEFORE:");
-  control_block_log_status();
+static void update_tick_mode();
 
-  cb.current_interval_seconds_left--;
+static void final_stretch_callback(void *data){
+  update_tick_mode();
+  draw_timer();
+}
 
-  if (cb.current_interval_seconds_left == 0){
-    cb.is_interval_over = true;
+static void peek_callback(void *data){
+  peeking = false;
+  update_tick_mode();
+  draw_timer();
+}
 
-    // Check if the program has more periods.
-    if (--cb.intervals_left > 0){
-        
-        // Unsubscrive as we are switching.
-        tick_timer_service_unsubscribe();
+// The boundary is coming.
+static void warning_callback(void *data){
+  buzz_short();
+}
 
-        // Move to the next period.
-        if (!cb.loop_first){
-          cb.current_interval++;
-          cb.current_interval_index++;
-        }
+// Picks the redraw resolution for the current state of the control block.
+// While more than POWER_SAVE_THRESHOLD_S are left in the interval we redraw
+// once a minute, and an event brings the seconds back for the final
+// stretch. Another one warns BOUNDARY_WARNING_S before the boundary, which
+// itself is posted by the control block, and reminders follow the new
+// timing. Steps are counted while the timer moves, and an auto-pause rests
+// the accelerometer. In low power mode only the boundary and the reminders
+// wake us, and steps are not counted.
+static void update_tick_mode(){
+  int64_t deadline = control_block_get_deadline_ms();
+  int ms_left;
+
+  scheduler_cancel(final_stretch_callback, NULL);
+  scheduler_cancel(warning_callback, NULL);
+
+  // Nothing moves while paused or once the program is over.
+  if (control_block_is_paused() || control_block_is_program_over()){
+    power_save = false;
+    set_tick_units(0);
+    reminders_stop();
+    set_accel_mode(auto_paused && !control_block_is_program_over() ? ACCEL_RESTING : ACCEL_OFF);
+    return;
+  }
+  set_accel_mode(power_is_low() ? ACCEL_OFF : ACCEL_COUNTING);
 
-        // Get seconds in the current period.
-        cb.current_interval_seconds_left = cb.current_interval->duration;
+  if (power_is_low() && !peeking){
+    power_save = false;
+    set_tick_units(0);
+    reminders_arm();
+    return;
+  }
 
-        APP_LOG(APP_LOG_LEVEL_DEBUG, "Next interval of the program, duration: %d", cb.current_interval_seconds_left);  
-        APP_LOG(APP_LOG_LEVEL_DEBUG, "Intervals left %d", cb.intervals_left);
-        
-        // Resubscribe.
-        tick_timer_service_subscribe(SECOND_UNIT, handle_tick);
+  ms_left = control_block_get_interval_ms_left();
+  power_save = !peeking && ms_left > POWER_SAVE_THRESHOLD_S * 1000;
 
-    } else {
-      cb.is_program_over = true;
-      tick_timer_service_unsubscribe();
-      APP_LOG(APP_LOG_LEVEL_DEBUG, "Completed the program!");  
-    }
-  } else {
-    cb.is_interval_over = false;
+  if (power_save){
+    scheduler_post(deadline - POWER_SAVE_THRESHOLD_S * 1000, final_stretch_callback, NULL);
   }
+  if (ms_left > BOUNDARY_WARNING_S * 1000){
+    scheduler_post(deadline - BOUNDARY_WARNING_S * 1000, warning_callback, NULL);
+  }
+  set_tick_units(power_save ? MINUTE_UNIT : SECOND_UNIT);
+  reminders_arm();
+}
 
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "Timer ticked, control state AFTER:");
-  control_block_log_status();
+static void linger_callback(void *data){
+  window_stack_pop_all(true);
 }
 
-// Returns true if the interval is over.
-static bool control_block_is_interval_over(){
-  return cb.is_interval_over;
+// A button was pressed: show seconds right away, for a while.
+static void peek(){
+  // The user is looking, stay open.
+  scheduler_cancel(linger_callback, NULL);
+
+  peeking = true;
+  scheduler_post_in(POWER_SAVE_PEEK_MS, peek_callback, NULL);
+  update_tick_mode();
+  draw_timer();
 }
 
-// Returns true if the program is over.
-static bool control_block_is_program_over(){
-  return cb.is_program_over;
+// Stops every timed event of the timer window.
+static void stop_ticking(){
+  scheduler_cancel(final_stretch_callback, NULL);
+  scheduler_cancel(warning_callback, NULL);
+  scheduler_cancel(peek_callback, NULL);
+  peeking = false;
+  power_save = false;
+  set_tick_units(0);
+  reminders_stop();
+  auto_paused = false;
+  set_accel_mode(ACCEL_OFF);
 }
 
+static void save_callback(void *data){
+  session_checkpoint(selected_menu_index, selected_program_id, selected_program_hash);
+}
 
-///////////////////////////////////////////////////////////////////////////////
-/*                              UTILITY FUNCTIONS                            */
-///////////////////////////////////////////////////////////////////////////////
-// Builds menu sections and items from a structure in resources.h
-static void build_menu_from_struc(struct menu_item *menu, int menu_size, SimpleMenuSection *menu_sections, SimpleMenuItem *menu_items, void *callback){
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "build_menu_from_struc: drawing menu layer. Menu size = %d", menu_size);  
+// The user changed the state of the workout, save it shortly: a burst of
+// presses is written once.
+static void checkpoint(){
+  scheduler_post_in(CHECKPOINT_DELAY_MS, save_callback, NULL);
+}
 
-  for(int i=0; i < menu_size; i++){
-    APP_LOG(APP_LOG_LEVEL_DEBUG, "build_menu_from_struc: adding an item %d: '%s'", i, menu[i].title);
+// The workout is over for good, nothing to save or resume.
+static void forget_session(){
+  scheduler_cancel(save_callback, NULL);
+  session_clear();
+}
 
-    menu_items[i] = (SimpleMenuItem){
-      .title = menu[i].title,
-      .subtitle = menu[i].subtitle,
-      .callback = callback,
-    };
-  }
+// The wearer stopped, at a traffic light say: pause until they move again
+// or tap the watch.
+static void auto_pause(){
+  control_block_pause();
+  auto_paused = true;
+  trace(TRACE_AUTO_PAUSE, control_block_get_interval_index());
+  buzz_short();
+  checkpoint();
+  update_tick_mode();
+  draw_timer();
+}
 
-  menu_sections[0] = (SimpleMenuSection){
-    .num_items = menu_size,
-    .items = menu_items,
-  };  
+static void auto_resume(){
+  if (!auto_paused){
+    return;
+  }
+  auto_paused = false;
+  control_block_resume();
+  trace(TRACE_AUTO_RESUME, control_block_get_interval_index());
+  buzz_short();
+  checkpoint();
+  update_tick_mode();
+  draw_timer();
+}
 
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "build_menu_from_struc: finished drawing a menu.");
+// The battery ran low or is charging: retime the workout for the new mode.
+static void handle_power_mode(bool low_power){
+  if (!timer_window || !workout_live){
+    return;
+  }
+  scheduler_hold();
+  update_tick_mode();
+  draw_timer();
+  scheduler_release();
 }
 
+// Handles the end of an interval, fired by the control block at the deadline.
+static void handle_boundary(bool program_over) {
+  // Pick the tick resolution for the new interval.
+  update_tick_mode();
 
-static void draw_timer(){
-  // Get seconds and minutes.  
-  int m = control_block_get_interval_seconds_left() / 60;
-  int s = control_block_get_interval_seconds_left() - (m * 60);
+  // Redraw the timer.
+  draw_timer();
 
-  // Update timer.
-  snprintf(timer_value, sizeof(timer_value) + 1, "%02d:%02d", m, s);
-  text_layer_set_text(tw_tl_time, timer_value); 
-  layer_mark_dirty((Layer *)tw_tl_time);
+  // Update UI.
+  if (program_over){
+      // No more ticks needed, and nothing to resume.
+      stop_ticking();
+      workout_live = false;
+      history_finish(HISTORY_COMPLETED, control_block_get_paused_ms());
+      forget_session();
 
-  // Update type.
-  if (control_block_get_interval_type() == INTERVAL_TYPE_RUN){
-    text_layer_set_text(tw_tl_type, MESSAGE_RUN); 
-  } else if (control_block_get_interval_type() == INTERVAL_TYPE_WALK) {
-    text_layer_set_text(tw_tl_type, MESSAGE_WALK); 
-  } else if (control_block_get_interval_type() == INTERVAL_TYPE_WARMUP) {
-    text_layer_set_text(tw_tl_type, MESSAGE_WARMUP);
-  } else if (control_block_get_interval_type() == INTERVAL_TYPE_COOLDOWN) {
-    text_layer_set_text(tw_tl_type, MESSAGE_COOLDOWN);
-  } else {
-    text_layer_set_text(tw_tl_type, control_block_get_program_title()); 
-  }
-  layer_mark_dirty((Layer *)tw_tl_type);
+      // Vibrate with different pattern at the end of the program.
+      buzz_double();
 
-  // Update period.
-  snprintf(interval_value, sizeof(interval_value) + 1, MESSAGE_PERIOD, (control_block_get_intervals_total()-control_block_get_intervals_left()) + 1, control_block_get_intervals_total());
-  text_layer_set_text(tw_tl_interval, interval_value); 
-  layer_mark_dirty((Layer *)tw_tl_interval);
-}
+      // And update the screen with a final message.
+      layer_set_hidden(digits_get_layer(&tw_digits), true);
+      layer_set_hidden((Layer *)tw_tl_interval, true);
+      layer_set_hidden((Layer *)tw_tl_total, true);
 
-// Handles tick of the system clock.
-static void handle_tick(struct tm *tick_time, TimeUnits units_changed) {
-    if(units_changed & SECOND_UNIT) {
-
-      // Update control block.
-      control_block_tick();
-    
-      // Redraw the timer.
-      draw_timer();
-    
-      // Update UI.
-      if (control_block_is_program_over()){
-          // Vibrate with different pattern at the end of the program.
-          vibes_double_pulse();
-    
-          // And update the screen with a final message.
-          layer_set_hidden((Layer *)tw_tl_time, true);
-          layer_set_hidden((Layer *)tw_tl_interval, true);
-    
-          text_layer_set_text(tw_tl_type, "Done!");
-          layer_mark_dirty((Layer *)tw_tl_type);
-    
-          return;
-      } else if (control_block_is_interval_over()){
-        vibes_long_pulse();
-      }
-    }  
+      text_layer_set_text(tw_tl_type, "Done!");
+      layer_mark_dirty((Layer *)tw_tl_type);
+  } else {
+    buzz_long();
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 /*                              BUTTON CLICK HANDLERS                        */
 ///////////////////////////////////////////////////////////////////////////////
+// A press moves several events (boundary, warnings, redraws, the save), the
+// handlers hold the scheduler so that the timer is set once for all of them.
+
 // Down click on timer window.
 void down_single_click_handler(ClickRecognizerRef recognizer, Window *window) {
+  if (control_block_is_program_over()){
+    return;
+  }
+
   // Go to the next period, if this is the last period, don't do anything.
-  if (control_block_get_intervals_left() > 1){
-    // Stop timer.
-    tick_timer_service_unsubscribe();
-    
+  scheduler_hold();
+  if (control_block_has_next_period()){
     control_block_next_period();
-    
-    // Start the timer.
-    tick_timer_service_subscribe(SECOND_UNIT, handle_tick);
+    history_skipped();
+    checkpoint();
   }
+  peek();
+  scheduler_release();
 }
 
 // Up click on timer window.
 void up_single_click_handler(ClickRecognizerRef recognizer, Window *window) {
-  // Stop timer.
-  tick_timer_service_unsubscribe();
-  
-  control_block_previous_period();
+  int index = control_block_get_interval_index();
+
+  if (control_block_is_program_over()){
+    return;
+  }
 
-  // Start the timer.
-  tick_timer_service_subscribe(SECOND_UNIT, handle_tick);
+  scheduler_hold();
+  control_block_previous_period();
+  if (control_block_get_interval_index() != index){
+    history_skipped();
+  }
+  checkpoint();
+  peek();
+  scheduler_release();
 }
 
 // Select click on timer window.
 void select_single_click_handler(ClickRecognizerRef recognizer, Window *window) {
-  if (timer_paused){
-    // Start the timer.
-    tick_timer_service_subscribe(SECOND_UNIT, handle_tick);
+  if (control_block_is_program_over()){
+    return;
+  }
+
+  // A pause with select stays until select, whatever the wearer does.
+  scheduler_hold();
+  auto_paused = false;
+  if (control_block_is_paused()){
+    control_block_resume();
   } else {
-    // Stop timer, to pause.
-    tick_timer_service_unsubscribe();
+    control_block_pause();
   }
-  timer_paused = !timer_paused;
+  checkpoint();
+
+  // Ticks stop while paused and come back on resume.
+  peek();
+  scheduler_release();
+}
+
+static void show_main_window();
+
+// Back on the timer window stops the workout for good. Leaving the app any
+// other way keeps it going, see session_suspend.
+void back_single_click_handler(ClickRecognizerRef recognizer, Window *window) {
+  if (workout_live){
+    history_finish(HISTORY_ABANDONED, control_block_get_paused_ms());
+  }
+  workout_live = false;
+  forget_session();
+
+  // Resumed straight into the timer window, the menus were never shown.
+  if (!main_window){
+    show_main_window();
+    window_stack_remove(timer_window, false);
+    return;
+  }
+  window_stack_pop(true);
+}
+
+// Long up or down click on timer window scrubs the program back or forward
+// to any point, not an interval at a time.
+static void scrub(int seconds){
+  int index = control_block_get_interval_index();
+
+  if (control_block_is_program_over()){
+    return;
+  }
+
+  scheduler_hold();
+  control_block_seek(control_block_get_position_ms() + seconds * 1000);
+  if (control_block_get_interval_index() != index){
+    history_skipped();
+  }
+  checkpoint();
+  peek();
+  scheduler_release();
+}
+
+void up_long_click_handler(ClickRecognizerRef recognizer, Window *window) {
+  scrub(-SCRUB_STEP_S);
+}
+
+void down_long_click_handler(ClickRecognizerRef recognizer, Window *window) {
+  scrub(SCRUB_STEP_S);
+}
+
+// Long select click on timer window dumps the trace buffer to the log.
+void select_long_click_handler(ClickRecognizerRef recognizer, Window *window) {
+  trace_dump();
 }
 
 void click_config_provider(Window *window) {
   window_single_click_subscribe(BUTTON_ID_UP, (ClickHandler) up_single_click_handler);
   window_single_click_subscribe(BUTTON_ID_DOWN, (ClickHandler) down_single_click_handler);
   window_single_click_subscribe(BUTTON_ID_SELECT, (ClickHandler) select_single_click_handler);
+  window_single_click_subscribe(BUTTON_ID_BACK, (ClickHandler) back_single_click_handler);
+  window_long_click_subscribe(BUTTON_ID_SELECT, 0, (ClickHandler) select_long_click_handler, NULL);
+  window_long_click_subscribe(BUTTON_ID_UP, 0, (ClickHandler) up_long_click_handler, NULL);
+  window_long_click_subscribe(BUTTON_ID_DOWN, 0, (ClickHandler) down_long_click_handler, NULL);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 /*                                        UI                                 */
 ///////////////////////////////////////////////////////////////////////////////
 
-// This callback will initialize the timer and starts the count down.
-static void program_menu_callback(int index, void *ctx) {
-  
-  if (selected_program_menu -> program_menu == interval_menu){
-    control_block_init(((selected_program_menu -> program_menu[index])).intervals, ((selected_program_menu -> program_menu[index])).title, ((selected_program_menu -> program_menu[index])).intervals_cnt, true);
-  } else {
-    control_block_init(((selected_program_menu -> program_menu[index])).intervals, ((selected_program_menu -> program_menu[index])).title, ((selected_program_menu -> program_menu[index])).intervals_cnt, false);
+// Window handlers, below with the layers they set up.
+static void main_window_load(Window *window);
+static void main_window_unload(Window *window);
+static void program_window_load(Window *window);
+static void program_window_unload(Window *window);
+static void timer_window_load(Window *window);
+static void timer_window_unload(Window *window);
+
+// Creates a window and pushes it. Its unload handler destroys it, so
+// nothing of a window is kept once it is popped.
+static Window *push_window(WindowHandlers handlers, ClickConfigProvider click_config_provider){
+  Window *window = window_create();
+
+  if (!window){
+    LOG_ERROR("Out of memory for a window.");
+    return NULL;
+  }
+  window_set_window_handlers(window, handlers);
+  if (click_config_provider){
+    window_set_click_config_provider(window, click_config_provider);
   }
+  window_stack_push(window, true);
+  return window;
+}
+
+static void show_main_window(){
+  main_window = push_window((WindowHandlers){
+    .load = main_window_load,
+    .unload = main_window_unload,
+  }, NULL);
+}
+
+// Shows the program menu at the given main menu row.
+static void show_program_window(int row){
+  selected_program_menu = malloc(sizeof(*selected_program_menu));
+  if (!selected_program_menu){
+    return;
+  }
+  if (!catalog_load_menu(row, selected_program_menu)){
+    free(selected_program_menu);
+    selected_program_menu = NULL;
+    return;
+  }
+  selected_menu_index = row;
+  LOG_DEBUG("Selected '%s' program menu.", selected_program_menu->label.title);
 
+  program_window = push_window((WindowHandlers){
+    .load = program_window_load,
+    .unload = program_window_unload,
+  }, NULL);
+  if (!program_window){
+    free(selected_program_menu);
+    selected_program_menu = NULL;
+  }
+}
+
+// Shows the timer window for the program in the control block.
+static void show_timer_window(){
   // Add the timer window to the stack.
-  window_stack_push(timer_window, true);
+  timer_window = push_window((WindowHandlers){
+    .load = timer_window_load,
+    .unload = timer_window_unload,
+  }, (ClickConfigProvider) click_config_provider);
+  if (!timer_window){
+    return;
+  }
+  workout_live = true;
+  motion_init(&motion);
 
   // Log the status of the control block.
   control_block_log_status();
 
+  // Start ticking.
+  update_tick_mode();
+
   // Set up timer screen.  
   draw_timer();
+}
 
-  // Start ticking.
-  tick_timer_service_subscribe(SECOND_UNIT, handle_tick);
- 
+// This callback will initialize the timer and starts the count down.
+static void program_menu_callback(MenuLayer *menu_layer, MenuIndex *cell_index, void *ctx) {
+  // Load the record and bytecode of the selected program only.
+  selected_program_id = selected_program_menu->first_program + cell_index->row;
+  if (!catalog_load_program_record(selected_program_id, &selected_program) ||
+      !catalog_load_program(selected_program_id, &selected_program, &program_code) ||
+      !control_block_init(&program_code, selected_program.label.title, handle_boundary)){
+    return;
+  }
+  selected_program_hash = catalog_program_hash(&selected_program, &program_code);
+  history_start(selected_program_id);
+  session_start();
+  ram_note("session start");
+  checkpoint();
+  show_timer_window();
 }
-// This callback will remove the main menu layer and draw the program menu instead.
-static void main_menu_callback(int index, void *ctx) {
-  selected_program_menu = &main_menu[index];
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "Selected '%s' program menu.", selected_program_menu -> title);  
 
-  Layer *window_layer = window_get_root_layer(program_window);
+// Loads the program of a saved session and rebuilds its control block.
+// Only the program's own record and bytecode are read. A catalog synced
+// since the checkpoint may have changed the program: the workout is then
+// dropped rather than resumed into other intervals.
+static bool restore_workout(const struct session *session){
+  selected_menu_index = session->menu_index;
+  selected_program_id = session->program_id;
+  selected_program_hash = session->program_hash;
+
+  if (!catalog_load_program_record(selected_program_id, &selected_program) ||
+      !catalog_load_program(selected_program_id, &selected_program, &program_code)){
+    return false;
+  }
+  if (catalog_program_hash(&selected_program, &program_code) != selected_program_hash){
+    LOG_WARNING("session: program %d changed, workout dropped", selected_program_id);
+    return false;
+  }
 
-  build_menu_from_struc(selected_program_menu->program_menu, selected_program_menu->program_menu_size, program_menu_sections, program_menu_items, program_menu_callback);
+  // The control block adds the boundaries it catches up with to the record.
+  history_restore(&session->history);
+  reminders_restore(session->reminders);
 
-  // The order of the next two statements are important.
-  window_stack_push(program_window, true);
+  return control_block_restore(&program_code, selected_program.label.title, handle_boundary, &session->state);
+}
 
-  layer_add_child(window_layer, simple_menu_layer_get_layer(program_menu_layer)); 
+// Launched by a wakeup or by the worker, for a boundary or a reminder.
+static bool launched_for_alert(){
+  return launch_reason() == APP_LAUNCH_WAKEUP || launch_reason() == APP_LAUNCH_WORKER;
 }
 
-// Main window is a menu window.
-static void main_window_load(Window *window) {
-  Layer *window_layer = window_get_root_layer(window);
-  GRect bounds = layer_get_frame(window_layer);
-  main_menu_layer = simple_menu_layer_create(bounds, window, main_menu_sections, 1, NULL);
+// The launch came after the boundary it was for, which the control block
+// caught up with: buzz it now.
+static void handle_missed_boundary(){
+  buzz_long();
+}
 
-  // Load main menu.
-  build_menu_from_struc(main_menu, sizeof(main_menu) / sizeof(struct menu_item), main_menu_sections, main_menu_items, main_menu_callback);
+// Picks up the workout saved in the last run of the app, straight into the
+// timer window without building the menus; they are pushed underneath when
+// the workout is stopped. When launched for an alert, we close again after
+// a while unless the user presses a button.
+static bool resume_workout(){
+  struct session session;
 
-  // Add the prepared layer to the screen.
-  layer_add_child(window_layer, (Layer *)main_menu_layer);
+  if (!session_resume(&session, handle_missed_boundary)){
+    return false;
+  }
+  if (!restore_workout(&session)){
+    session_clear();
+    return false;
+  }
+  ram_note("session resume");
+  show_timer_window();
 
-  // Note: It's beyond me at the moment why I need to do that, considering
-  // I don't need to call menu_layer_reload_date for other menus and
-  // I am drawing this menu only once, but it fixes the scrolling issue.
-  menu_layer_reload_data(simple_menu_layer_get_menu_layer(main_menu_layer));
+  if (session_missed_boundary()){
+    handle_missed_boundary();
+  }
+  if (launched_for_alert()){
+    scheduler_post_in(SESSION_LINGER_MS, linger_callback, NULL);
+  }
+  return true;
 }
 
-// Deinitialize resources on window unload that were initialized on window load
-void main_window_unload(Window *window) {
-  simple_menu_layer_destroy(main_menu_layer);
+static uint16_t main_menu_get_num_rows(MenuLayer *menu_layer, uint16_t section_index, void *ctx){
+  return catalog_menu_count();
 }
 
-// Program window is another menu window.
-void program_window_load(Window *window) {
+static void main_menu_draw_row(GContext *ctx, const Layer *cell_layer, MenuIndex *cell_index, void *data){
+  struct catalog_menu menu;
+
+  if (catalog_load_menu(cell_index->row, &menu)){
+    draw_menu_row(ctx, cell_layer, &menu.label);
+  }
+}
+
+// This callback opens the program menu of the selected row.
+static void main_menu_callback(MenuLayer *menu_layer, MenuIndex *cell_index, void *ctx) {
+  show_program_window(cell_index->row);
+}
+
+static uint16_t program_menu_get_num_rows(MenuLayer *menu_layer, uint16_t section_index, void *ctx){
+  return selected_program_menu->program_count;
+}
+
+// A program on as a reminder says so in place of its subtitle.
+static void program_menu_draw_row(GContext *ctx, const Layer *cell_layer, MenuIndex *cell_index, void *data){
+  int program_id = selected_program_menu->first_program + cell_index->row;
+  struct catalog_program program;
+
+  if (!catalog_load_program_record(program_id, &program)){
+    return;
+  }
+  if (reminders_is_on(program_id)){
+    snprintf(program.label.subtitle, sizeof(program.label.subtitle), "%s", MESSAGE_REMINDER);
+  }
+  draw_menu_row(ctx, cell_layer, &program.label);
+}
+
+// Long select on a program of periodic intervals turns it on or off as a
+// reminder for the workouts to come, see reminders.h. No workout runs
+// while the menus are up, so its bytecode is read where a workout's goes.
+static void program_menu_long_callback(MenuLayer *menu_layer, MenuIndex *cell_index, void *ctx){
+  int program_id = selected_program_menu->first_program + cell_index->row;
+  struct interval interval;
+
+  if (!catalog_load_program_record(program_id, &selected_program) ||
+      !catalog_load_program(program_id, &selected_program, &program_code) ||
+      !program_interval_at(&program_code, 0, &interval) ||
+      interval.type != INTERVAL_TYPE_PERIODIC){
+    return;
+  }
+  reminders_toggle(program_id, interval.duration);
+  menu_layer_reload_data(menu_layer);
+}
+
+// The catalog changed, a new one came from the phone or the old one gave
+// way to the resource while it comes in: the menus show it from now on. A
+// workout already running keeps the bytecode it was started with.
+static void handle_sync(){
+  catalog_init();
+
+  if (main_window){
+    menu_layer_reload_data(main_menu_layer);
+  }
+  if (program_window){
+    if (!catalog_load_menu(selected_menu_index, selected_program_menu)){
+      selected_program_menu->program_count = 0;
+    }
+    menu_layer_reload_data(program_menu_layer);
+  }
+}
+
+// Creates a menu layer filling the window. Rows are drawn on demand by the
+// callbacks, so nothing is copied however long the menu is.
+static MenuLayer *create_menu_layer(Window *window, MenuLayerCallbacks callbacks){
   Layer *window_layer = window_get_root_layer(window);
-  GRect bounds = layer_get_frame(window_layer);
-  program_menu_layer = simple_menu_layer_create(bounds, window, program_menu_sections, 1, NULL);
+  MenuLayer *menu_layer = menu_layer_create(layer_get_frame(window_layer));
+
+  menu_layer_set_callbacks(menu_layer, NULL, callbacks);
+  menu_layer_set_click_config_onto_window(menu_layer, window);
+  layer_add_child(window_layer, menu_layer_get_layer(menu_layer));
+  return menu_layer;
 }
 
-void program_window_unload(Window *window) {
-  simple_menu_layer_destroy(program_menu_layer);
+// Main window is a menu window.
+static void main_window_load(Window *window) {
+  main_menu_layer = create_menu_layer(window, (MenuLayerCallbacks){
+    .get_num_rows = main_menu_get_num_rows,
+    .draw_row = main_menu_draw_row,
+    .select_click = main_menu_callback,
+  });
+  ram_note("main load");
+}
+
+// Deinitialize resources on window unload that were initialized on window
+// load, and the window itself.
+static void main_window_unload(Window *window) {
+  menu_layer_destroy(main_menu_layer);
+  window_destroy(window);
+  main_window = NULL;
+  ram_note("main unload");
+}
+
+// Program window is another menu window, listing the selected menu.
+static void program_window_load(Window *window) {
+  program_menu_layer = create_menu_layer(window, (MenuLayerCallbacks){
+    .get_num_rows = program_menu_get_num_rows,
+    .draw_row = program_menu_draw_row,
+    .select_click = program_menu_callback,
+    .select_long_click = program_menu_long_callback,
+  });
+  reminders_load();
+  ram_note("program load");
 }
 
-// Timer window contains three text layers that are setup here.
-void timer_window_load(Window *window) {
-  Layer *window_layer = window_get_root_layer(timer_window);
+// Back on the main menu: the menu record goes with the window.
+static void program_window_unload(Window *window) {
+  menu_layer_destroy(program_menu_layer);
+  window_destroy(window);
+  program_window = NULL;
+  free(selected_program_menu);
+  selected_program_menu = NULL;
+  ram_note("program unload");
+}
+
+// Timer window contains the digits and three text layers that are setup
+// here. Each layer ends where the next one starts, which is all of it that
+// was ever visible, so invalidating one line does not repaint the lines
+// below it.
+static void timer_window_load(Window *window) {
+  Layer *window_layer = window_get_root_layer(window);
   GRect bounds = layer_get_frame(window_layer);
 
-  // Setup time text.
-  tw_tl_time = text_layer_create((GRect){ .origin = { 0, 10 }, .size = bounds.size });
-  text_layer_set_text(tw_tl_time, "00:00");
-  text_layer_set_font(tw_tl_time, fonts_get_system_font(FONT_KEY_BITHAM_42_LIGHT));
-  text_layer_set_text_alignment(tw_tl_time, GTextAlignmentCenter);
-  layer_add_child(window_layer, text_layer_get_layer(tw_tl_time));
+  forget_shown();
+
+  // Setup time digits.
+  if (digits_create(&tw_digits, (GRect){ .origin = { 0, 10 }, .size = { bounds.size.w, 44 } })){
+    layer_add_child(window_layer, digits_get_layer(&tw_digits));
+  }
 
   // Setup action type text.
-  tw_tl_type = text_layer_create((GRect){ .origin = { 0, 54 }, .size = bounds.size });
+  tw_tl_type = text_layer_create((GRect){ .origin = { 0, 54 }, .size = { bounds.size.w, 52 } });
   text_layer_set_text(tw_tl_type, "Walk");
   text_layer_set_font(tw_tl_type, fonts_get_system_font(FONT_KEY_BITHAM_42_BOLD));
   text_layer_set_text_alignment(tw_tl_type, GTextAlignmentCenter);
   layer_add_child(window_layer, text_layer_get_layer(tw_tl_type));
 
   // Setup period count text.
-  tw_tl_interval = text_layer_create((GRect){ .origin = { 0, 106 }, .size = bounds.size });
+  tw_tl_interval = text_layer_create((GRect){ .origin = { 0, 106 }, .size = { bounds.size.w, 28 } });
   text_layer_set_text(tw_tl_interval, "period 1 of 6");
   text_layer_set_font(tw_tl_interval, fonts_get_system_font(FONT_KEY_GOTHIC_24));
   text_layer_set_text_alignment(tw_tl_interval, GTextAlignmentCenter);
   layer_add_child(window_layer, text_layer_get_layer(tw_tl_interval));
+
+  // Setup whole program text, left empty for programs without an end.
+  tw_tl_total = text_layer_create((GRect){ .origin = { 0, 134 }, .size = { bounds.size.w, bounds.size.h - 134 } });
+  text_layer_set_text(tw_tl_total, "");
+  text_layer_set_font(tw_tl_total, fonts_get_system_font(FONT_KEY_GOTHIC_18));
+  text_layer_set_text_alignment(tw_tl_total, GTextAlignmentCenter);
+  layer_add_child(window_layer, text_layer_get_layer(tw_tl_total));
+  ram_note("timer load");
 }
 
-void timer_window_unload(Window *window) {
-  tick_timer_service_unsubscribe();
+static void timer_window_unload(Window *window) {
+  scheduler_cancel(linger_callback, NULL);
+  stop_ticking();
+  control_block_stop();
 
-  text_layer_destroy(tw_tl_time);
+  digits_destroy(&tw_digits);
   text_layer_destroy(tw_tl_type);
   text_layer_destroy(tw_tl_interval);
+  text_layer_destroy(tw_tl_total);
+  window_destroy(window);
+  timer_window = NULL;
+  ram_note("timer unload");
 }
 
 int main(void) {
 
-  // Create windows and setup handlers.
-  main_window = window_create();
-  program_window = window_create();
-  timer_window = window_create();
+  // Read the program catalog header.
+  catalog_init();
 
+  // Follow the battery, before the workout is timed.
+  power_init(handle_power_mode);
 
-  window_set_window_handlers(main_window, (WindowHandlers) {
-    .load = main_window_load,
-    .unload = main_window_unload,
-  });
+  // Take catalog updates from the phone, unless we are only up for a
+  // boundary.
+  if (!launched_for_alert()){
+    sync_init(handle_sync);
+  }
 
-  window_set_window_handlers(program_window, (WindowHandlers) {
-    .load = program_window_load,
-    .unload = program_window_unload,
-  });
+  // Pick up a workout left running when the app was closed, or push the
+  // main window.
+  if (!resume_workout()){
+    show_main_window();
+  }
 
-  window_set_window_handlers(timer_window, (WindowHandlers) {
-    .load = timer_window_load,
-    .unload = timer_window_unload,
-  });
-  window_set_click_config_provider(timer_window, (ClickConfigProvider) click_config_provider);
+  app_event_loop();
+  sync_deinit();
+  power_deinit();
 
-  // Push main window.
-  window_stack_push(main_window, true);
+  // A checkpoint still waiting is written now.
+  scheduler_run_now(save_callback, NULL);
 
-  app_event_loop();
+  // Closed mid-workout: carry on in the background until the next boundary.
+  if (workout_live){
+    session_suspend();
+  }
+
+  // Unload and destroy the windows still up.
+  window_stack_pop_all(false);
+  scheduler_deinit();
 
-  // Destroy Windows.
-  window_destroy(main_window);
-  window_destroy(program_window);
-  window_destroy(timer_window);
+  return 0;
 }
\ No newline at end of file
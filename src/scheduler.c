@@ -0,0 +1,197 @@
+#include "pebble.h"
+#include "scheduler.h"
+#include "log.h"
+
+static struct {
+    // Min-heap on deadline, then order of posting.
+    struct scheduler_event heap[SCHEDULER_MAX_EVENTS];
+    int count;
+    uint32_t seq;
+
+    // The app_timer and the deadline it is set for.
+    AppTimer *timer;
+    int64_t timer_at_ms;
+
+    // Held inside a wakeup or by the app, the timer is set once at the
+    // last release.
+    int held;
+} scheduler;
+
+static void scheduler_arm();
+
+// Current time in milliseconds.
+int64_t scheduler_now_ms(){
+  time_t seconds;
+  uint16_t ms;
+
+  time_ms(&seconds, &ms);
+  return (int64_t)seconds * 1000 + ms;
+}
+
+static bool scheduler_before(const struct scheduler_event *a, const struct scheduler_event *b){
+  return a->at_ms < b->at_ms || (a->at_ms == b->at_ms && a->seq < b->seq);
+}
+
+static void scheduler_swap(int i, int j){
+  struct scheduler_event event = scheduler.heap[i];
+
+  scheduler.heap[i] = scheduler.heap[j];
+  scheduler.heap[j] = event;
+}
+
+// Restore the heap after the event at i changed.
+static void scheduler_sift(int i){
+  struct scheduler_event *heap = scheduler.heap;
+
+  while (i > 0 && scheduler_before(&heap[i], &heap[(i - 1) / 2])){
+    scheduler_swap(i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
+  for (;;){
+    int first = i;
+    int left = 2 * i + 1;
+    int right = left + 1;
+
+    if (left < scheduler.count && scheduler_before(&heap[left], &heap[first])){
+      first = left;
+    }
+    if (right < scheduler.count && scheduler_before(&heap[right], &heap[first])){
+      first = right;
+    }
+    if (first == i){
+      return;
+    }
+    scheduler_swap(i, first);
+    i = first;
+  }
+}
+
+static int scheduler_find(SchedulerHandler handler, void *context){
+  for (int i = 0; i < scheduler.count; i++){
+    if (scheduler.heap[i].handler == handler && scheduler.heap[i].context == context){
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void scheduler_remove(int i){
+  scheduler.heap[i] = scheduler.heap[--scheduler.count];
+  if (i < scheduler.count){
+    scheduler_sift(i);
+  }
+}
+
+// Run every event that is due, however many, then set the timer once.
+static void scheduler_wakeup(void *data){
+  int64_t now = scheduler_now_ms();
+
+  scheduler.timer = NULL;
+  scheduler_hold();
+
+  while (scheduler.count > 0 && scheduler.heap[0].at_ms <= now){
+    struct scheduler_event event = scheduler.heap[0];
+
+    scheduler_remove(0);
+    event.handler(event.context);
+  }
+
+  scheduler_release();
+}
+
+// Keep the app_timer on the earliest deadline. It is only touched when
+// that deadline moved.
+static void scheduler_arm(){
+  int64_t timeout;
+
+  if (scheduler.held > 0){
+    return;
+  }
+  if (scheduler.count == 0){
+    if (scheduler.timer){
+      app_timer_cancel(scheduler.timer);
+      scheduler.timer = NULL;
+    }
+    return;
+  }
+  if (scheduler.timer && scheduler.timer_at_ms == scheduler.heap[0].at_ms){
+    return;
+  }
+
+  scheduler.timer_at_ms = scheduler.heap[0].at_ms;
+  timeout = scheduler.timer_at_ms - scheduler_now_ms();
+  if (timeout < 0){
+    timeout = 0;
+  }
+  if (!scheduler.timer || !app_timer_reschedule(scheduler.timer, (uint32_t)timeout)){
+    scheduler.timer = app_timer_register((uint32_t)timeout, scheduler_wakeup, NULL);
+  }
+}
+
+// Post an event for the given time, or move it there if it is pending.
+// Returns false when the heap is full.
+bool scheduler_post(int64_t at_ms, SchedulerHandler handler, void *context){
+  int i = scheduler_find(handler, context);
+
+  if (i < 0){
+    if (scheduler.count == SCHEDULER_MAX_EVENTS){
+      LOG_ERROR("scheduler: no room for another event");
+      return false;
+    }
+    i = scheduler.count++;
+  }
+
+  scheduler.heap[i] = (struct scheduler_event){
+    .at_ms = at_ms,
+    .seq = scheduler.seq++,
+    .handler = handler,
+    .context = context,
+  };
+  scheduler_sift(i);
+  scheduler_arm();
+  return true;
+}
+
+// Post an event for the given time from now.
+bool scheduler_post_in(int32_t delay_ms, SchedulerHandler handler, void *context){
+  return scheduler_post(scheduler_now_ms() + delay_ms, handler, context);
+}
+
+void scheduler_cancel(SchedulerHandler handler, void *context){
+  int i = scheduler_find(handler, context);
+
+  if (i >= 0){
+    scheduler_remove(i);
+    scheduler_arm();
+  }
+}
+
+bool scheduler_pending(SchedulerHandler handler, void *context){
+  return scheduler_find(handler, context) >= 0;
+}
+
+// Run a pending event right away, as when the app is closing.
+void scheduler_run_now(SchedulerHandler handler, void *context){
+  if (scheduler_pending(handler, context)){
+    scheduler_cancel(handler, context);
+    handler(context);
+  }
+}
+
+// Leave the timer alone until the matching release.
+void scheduler_hold(){
+  scheduler.held++;
+}
+
+void scheduler_release(){
+  if (scheduler.held > 0 && --scheduler.held == 0){
+    scheduler_arm();
+  }
+}
+
+// Drop every event and the timer.
+void scheduler_deinit(){
+  scheduler.count = 0;
+  scheduler.held = 0;
+  scheduler_arm();
+}
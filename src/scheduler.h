@@ -0,0 +1,41 @@
+#pragma once
+
+#include "pebble.h"
+
+// Scheduler: the one time source of the app. Everything that has to happen
+// at a given time (interval boundaries, redraws, the final stretch, warnings
+// before a boundary, saving the session, ...) posts an event with its
+// deadline to a small min-heap, and a single app_timer is kept set to the
+// earliest one. A wakeup runs every event that is due, in deadline order,
+// then sets the timer once for the next; nothing subscribes to ticks.
+//
+// An event is known by its handler and context: posting it again moves it.
+//
+// Between scheduler_hold and scheduler_release the timer is left alone and
+// set once at the release, however many events were posted or cancelled,
+// as a wakeup does for the events it runs. Holds nest.
+#define SCHEDULER_MAX_EVENTS 16
+
+typedef void (*SchedulerHandler)(void *context);
+
+struct scheduler_event {
+    int64_t at_ms;
+
+    // Order of posting, breaks ties between equal deadlines.
+    uint32_t seq;
+
+    SchedulerHandler handler;
+    void *context;
+};
+
+// Current time in milliseconds.
+int64_t scheduler_now_ms();
+
+bool scheduler_post(int64_t at_ms, SchedulerHandler handler, void *context);
+bool scheduler_post_in(int32_t delay_ms, SchedulerHandler handler, void *context);
+void scheduler_cancel(SchedulerHandler handler, void *context);
+bool scheduler_pending(SchedulerHandler handler, void *context);
+void scheduler_run_now(SchedulerHandler handler, void *context);
+void scheduler_hold();
+void scheduler_release();
+void scheduler_deinit();
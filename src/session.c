@@ -0,0 +1,154 @@
+#include "pebble.h"
+#include "session.h"
+#include "background.h"
+#include "scheduler.h"
+#include "log.h"
+
+// Last checkpoint written, to skip writes that would not change anything.
+static struct session session_written;
+
+// Cookie of the alert this launch was for, by a wakeup or by the worker, 0
+// for none, and who to tell when the worker's launch came too late.
+static int32_t launch_cookie;
+static SessionMissedHandler missed_handler;
+
+// A workout starts: get the worker up, so that it is there to carry the
+// workout whenever the app is closed. Without it, wakeups do.
+void session_start(){
+  AppWorkerResult result = app_worker_launch();
+
+  if (result != APP_WORKER_RESULT_SUCCESS && result != APP_WORKER_RESULT_ALREADY_RUNNING){
+    LOG_INFO("session: no worker, result %d", (int)result);
+  }
+}
+
+// Write a checkpoint of the running workout, if it changed.
+void session_checkpoint(int menu_index, int program_id, uint32_t program_hash){
+  struct session session;
+
+  memset(&session, 0, sizeof(session));
+  session.version = SESSION_VERSION;
+  session.menu_index = menu_index;
+  session.program_id = program_id;
+  session.program_hash = program_hash;
+  control_block_save(&session.state);
+  session.history = *history_current();
+  reminders_save(session.reminders);
+
+  if (memcmp(&session, &session_written, sizeof(session)) == 0){
+    return;
+  }
+
+  if (persist_write_data(SESSION_PERSIST_KEY, &session, sizeof(session)) != sizeof(session)){
+    LOG_ERROR("session: cannot save");
+    return;
+  }
+  session_written = session;
+  LOG_DEBUG("session: checkpoint at interval %d", (int)session.state.interval_index);
+}
+
+// The app is closing mid-workout: have it launched again for the current
+// boundary, its cookie is the index of the interval the boundary starts, or
+// for a reminder before it, cookie 0. The worker, if up, is told when; it
+// launches the app BACKGROUND_LEAD_MS ahead. Otherwise a wakeup is
+// scheduled, with a resolution of a second: rounding down relaunches the
+// app just before the deadline. Either way the scheduler fires it on time.
+void session_suspend(){
+  time_t now = time(NULL);
+  int64_t at_ms = control_block_get_deadline_ms();
+  int64_t reminder_ms = reminders_next_ms();
+  int32_t cookie = control_block_get_interval_index() + 1;
+  int64_t in_ms;
+  time_t at;
+  WakeupId wakeup_id;
+
+  if (control_block_is_paused() || control_block_is_program_over()){
+    return;
+  }
+  if (reminder_ms >= 0 && reminder_ms < at_ms){
+    at_ms = reminder_ms;
+    cookie = 0;
+  }
+
+  if (app_worker_is_running()){
+    in_ms = at_ms - scheduler_now_ms();
+    if (in_ms < 0){
+      in_ms = 0;
+    }
+    app_worker_send_message(BACKGROUND_MSG_ALERT, &(AppWorkerMessage){
+      .data0 = (uint16_t)(in_ms >> 16),
+      .data1 = (uint16_t)in_ms,
+      .data2 = (uint16_t)cookie,
+    });
+    return;
+  }
+
+  at = (time_t)(at_ms / 1000);
+  if (at <= now){
+    at = now + 1;
+  }
+
+  wakeup_id = wakeup_schedule(at, cookie, true);
+  if (wakeup_id < 0){
+    LOG_WARNING("session: cannot schedule wakeup, error %d", (int)wakeup_id);
+  }
+}
+
+// The worker answers the app's launch with the alert it launched it for.
+static void session_worker_handler(uint16_t type, AppWorkerMessage *message){
+  if (type != BACKGROUND_MSG_LAUNCHED){
+    return;
+  }
+  launch_cookie = message->data0;
+  if (session_missed_boundary() && missed_handler){
+    missed_handler();
+  }
+}
+
+// Read the saved workout, if any. Pending wakeups are cancelled and the
+// worker stands down: while the app runs the control block fires boundaries
+// itself. The worker's answer comes later, to missed_handler.
+bool session_resume(struct session *session, SessionMissedHandler handler){
+  WakeupId wakeup_id;
+
+  wakeup_cancel_all();
+  launch_cookie = 0;
+  if (launch_reason() == APP_LAUNCH_WAKEUP){
+    wakeup_get_launch_event(&wakeup_id, &launch_cookie);
+  }
+
+  if (persist_read_data(SESSION_PERSIST_KEY, session, sizeof(*session)) != sizeof(*session) ||
+      session->version != SESSION_VERSION){
+    // Nothing for the worker to carry.
+    app_worker_kill();
+    return false;
+  }
+
+  if (app_worker_is_running()){
+    missed_handler = handler;
+    app_worker_message_subscribe(session_worker_handler);
+    app_worker_send_message(BACKGROUND_MSG_STAND_DOWN, &(AppWorkerMessage){ 0 });
+  }
+
+  session_written = *session;
+  LOG_DEBUG("session: resuming at interval %d", (int)session->state.interval_index);
+  return true;
+}
+
+// True if a boundary wakeup or the worker launched the app too late for the
+// control block's timer to fire it: the boundary was skipped while catching
+// up.
+bool session_missed_boundary(){
+  return launch_cookie > 0 && control_block_get_interval_index() >= launch_cookie;
+}
+
+// Forget the saved workout, it was stopped or is over. The worker goes with
+// it.
+void session_clear(){
+  app_worker_message_unsubscribe();
+  app_worker_kill();
+  memset(&session_written, 0, sizeof(session_written));
+  if (persist_exists(SESSION_PERSIST_KEY)){
+    persist_delete(SESSION_PERSIST_KEY);
+  }
+}
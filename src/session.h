@@ -0,0 +1,50 @@
+#pragma once
+
+#include "pebble.h"
+#include "control_block.h"
+#include "history.h"
+#include "reminders.h"
+
+// Persist keys.
+#define SESSION_PERSIST_KEY 1
+
+#define SESSION_VERSION 6
+
+// A workout that outlives the app. A checkpoint is written whenever the
+// user changes the state of the workout (start, skip, scrub, pause, resume),
+// never on ticks or boundaries: timing is absolute, so everything else
+// follows from the clock. When the app is closed mid-workout the background
+// worker, or a wakeup without it, launches it again for the next boundary or
+// reminder, so nothing of the app runs in between. The next launch, by the
+// worker, by that wakeup, by the user, or after a crash, picks the workout
+// up where the clock says it is.
+struct session {
+    uint8_t version;
+
+    // Main menu row and catalog program number of the workout, and the
+    // hash of the program, see catalog_program_hash. A sync in between may
+    // have put another program under that number, or changed this one.
+    uint8_t menu_index;
+    uint16_t program_id;
+    uint32_t program_hash;
+
+    struct control_block_state state;
+
+    // History record of the workout so far. Boundaries crossed since the
+    // checkpoint are added again when the control block catches up.
+    struct history_record history;
+
+    // Reminders the workout was started with.
+    struct reminder reminders[REMINDERS_MAX];
+};
+
+// Called when the worker tells the app it launched it for a boundary that
+// was missed, see session_missed_boundary.
+typedef void (*SessionMissedHandler)();
+
+void session_start();
+void session_checkpoint(int menu_index, int program_id, uint32_t program_hash);
+void session_suspend();
+bool session_resume(struct session *session, SessionMissedHandler missed_handler);
+bool session_missed_boundary();
+void session_clear();
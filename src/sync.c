@@ -0,0 +1,434 @@
+#include "pebble.h"
+#include "sync.h"
+#include "scheduler.h"
+#include "log.h"
+
+// What a program key holds.
+struct sync_program {
+    uint32_t hash;
+    uint8_t blob[SYNC_PROGRAM_MAX];
+};
+
+// Transfer in progress, see sync.h.
+static struct {
+  SyncHandler handler;
+  bool active;
+
+  // Data bytes that fit in a chunk, given our inbox.
+  uint16_t chunk_size;
+
+  // Hash of the manifest the phone announced.
+  uint32_t phone_hash;
+
+  // Blob being received: bytes so far, its size once known, and the offset
+  // last asked for. A request that cannot go out yet is sent when the
+  // outbox frees up.
+  uint16_t blob;
+  uint16_t received;
+  uint16_t size;
+  uint16_t asked;
+  bool ask_pending;
+
+  // Next program to compare with the manifest, and the bytes the ones
+  // before it take in storage.
+  int next_program;
+  size_t stored;
+
+  // Hash of the last manifest refused for its size: the phone says hello
+  // with it again and again, and it is not fetched again.
+  uint32_t refused_hash;
+} sync;
+
+// Manifest being synced, and the program being received.
+static uint8_t sync_manifest[SYNC_MANIFEST_MAX];
+static struct sync_program sync_program;
+
+// CRC-32 (IEEE 802.3), bit by bit: chunks are small and the table would
+// cost a kilobyte. Pass 0 to start.
+uint32_t sync_crc32(uint32_t crc, const void *data, size_t size){
+  const uint8_t *bytes = data;
+
+  crc = ~crc;
+  while (size--){
+    crc ^= *bytes++;
+    for (int bit = 0; bit < 8; bit++){
+      crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+  }
+  return ~crc;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/*                                  STORAGE                                  */
+///////////////////////////////////////////////////////////////////////////////
+// True if a synced catalog is stored, it then replaces the resource.
+bool sync_catalog_stored(){
+  return persist_exists(SYNC_STATE_KEY);
+}
+
+// Read a byte range of the stored manifest, across its pages.
+bool sync_read_manifest(uint32_t offset, void *buffer, size_t size){
+  uint8_t page[PERSIST_DATA_MAX_LENGTH];
+  uint8_t *out = buffer;
+
+  while (size > 0){
+    uint32_t index = offset / PERSIST_DATA_MAX_LENGTH;
+    uint32_t at = offset % PERSIST_DATA_MAX_LENGTH;
+    size_t count = size < PERSIST_DATA_MAX_LENGTH - at ? size : PERSIST_DATA_MAX_LENGTH - at;
+
+    if (index >= SYNC_MANIFEST_PAGES ||
+        persist_read_data(SYNC_MANIFEST_KEY + index, page, at + count) != (int)(at + count)){
+      return false;
+    }
+    memcpy(out, page + at, count);
+    out += count;
+    offset += count;
+    size -= count;
+  }
+  return true;
+}
+
+// Read a byte range of a stored program blob.
+bool sync_read_program(int program_id, uint32_t offset, void *buffer, size_t size){
+  size_t wanted = sizeof(sync_program.hash) + offset + size;
+  struct sync_program entry;
+
+  if (program_id < 0 || program_id >= SYNC_MAX_PROGRAMS || offset + size > SYNC_PROGRAM_MAX ||
+      persist_read_data(SYNC_PROGRAM_KEY + program_id, &entry, wanted) != (int)wanted){
+    return false;
+  }
+  memcpy(buffer, entry.blob + offset, size);
+  return true;
+}
+
+static bool sync_stored_hash(int program_id, uint32_t *hash){
+  return persist_read_data(SYNC_PROGRAM_KEY + program_id, hash, sizeof(*hash)) == sizeof(*hash);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/*                                  MANIFEST                                 */
+///////////////////////////////////////////////////////////////////////////////
+static const struct catalog_header *sync_manifest_header(){
+  return (const struct catalog_header *)sync_manifest;
+}
+
+// The hashes follow the menu records.
+static size_t sync_manifest_hashes_offset(){
+  return sizeof(struct catalog_header) + sync_manifest_header()->menu_count * sizeof(struct catalog_menu);
+}
+
+static size_t sync_manifest_expected_size(){
+  return sync_manifest_hashes_offset() + sync_manifest_header()->program_count * sizeof(uint32_t);
+}
+
+static uint32_t sync_manifest_hash(int program_id){
+  uint32_t hash;
+
+  memcpy(&hash, sync_manifest + sync_manifest_hashes_offset() + program_id * sizeof(hash), sizeof(hash));
+  return hash;
+}
+
+static bool sync_manifest_valid(){
+  const struct catalog_header *header = sync_manifest_header();
+
+  return sync.size >= sizeof(*header) &&
+         memcmp(header->magic, "RC", 2) == 0 &&
+         header->version == CATALOG_VERSION &&
+         header->program_count <= SYNC_MAX_PROGRAMS &&
+         sync.size == sync_manifest_expected_size() &&
+         sync_crc32(0, sync_manifest, sync.size) == sync.phone_hash;
+}
+
+// Whether the catalog fits in SYNC_STORED_BUDGET with size more bytes
+// stored before program next, the programs from there on at their
+// smallest.
+static bool sync_within_budget(size_t size, int next){
+  int left = sync_manifest_header()->program_count - next;
+
+  return sync_manifest_expected_size() + sync.stored + size + left * SYNC_PROGRAM_MIN_STORED <= SYNC_STORED_BUDGET;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/*                                  TRANSFER                                 */
+///////////////////////////////////////////////////////////////////////////////
+static void sync_timeout_callback(void *data);
+
+static void sync_stop(){
+  scheduler_cancel(sync_timeout_callback, NULL);
+  sync.active = false;
+  sync.ask_pending = false;
+}
+
+static void sync_timeout_callback(void *data){
+  LOG_WARNING("sync: no answer from the phone, stopped at blob %d", sync.blob);
+  sync_stop();
+}
+
+// The phone is still sending, give it another SYNC_TIMEOUT_MS.
+static void sync_keep_alive(){
+  scheduler_post_in(SYNC_TIMEOUT_MS, sync_timeout_callback, NULL);
+}
+
+// Ask for the current blob from where we are.
+static void sync_ask(){
+  DictionaryIterator *iter;
+
+  sync.ask_pending = true;
+  if (app_message_outbox_begin(&iter) != APP_MSG_OK){
+    return;
+  }
+  dict_write_uint8(iter, SYNC_KEY_OP, SYNC_OP_REQUEST);
+  dict_write_uint16(iter, SYNC_KEY_BLOB, sync.blob);
+  dict_write_uint16(iter, SYNC_KEY_OFFSET, sync.received);
+  dict_write_uint16(iter, SYNC_KEY_SIZE, sync.chunk_size);
+  dict_write_end(iter);
+
+  if (app_message_outbox_send() == APP_MSG_OK){
+    sync.ask_pending = false;
+    sync.asked = sync.received;
+  }
+  if (!scheduler_pending(sync_timeout_callback, NULL)){
+    scheduler_post_in(SYNC_TIMEOUT_MS, sync_timeout_callback, NULL);
+  }
+}
+
+static void sync_begin_blob(uint16_t blob){
+  sync.active = true;
+  sync.blob = blob;
+  sync.received = 0;
+  sync.size = 0;
+  sync_keep_alive();
+  sync_ask();
+}
+
+// Store the manifest and let it feed the menus. The state key goes first
+// and comes back last, so a manifest half written is never used. The
+// programs came after the manifest, so its size is worked out again.
+static void sync_commit(){
+  int count = sync_manifest_header()->program_count;
+  int manifest_size = sync_manifest_expected_size();
+  struct sync_state state = {
+    .manifest_hash = sync.phone_hash,
+    .manifest_size = manifest_size,
+  };
+
+  sync_stop();
+  persist_delete(SYNC_STATE_KEY);
+
+  for (int page = 0; page < SYNC_MANIFEST_PAGES; page++){
+    int at = page * PERSIST_DATA_MAX_LENGTH;
+    int size = manifest_size - at;
+
+    if (size <= 0){
+      persist_delete(SYNC_MANIFEST_KEY + page);
+    } else if (persist_write_data(SYNC_MANIFEST_KEY + page, sync_manifest + at, size < PERSIST_DATA_MAX_LENGTH ? size : PERSIST_DATA_MAX_LENGTH) < 0){
+      LOG_ERROR("sync: cannot store the manifest");
+      return;
+    }
+  }
+
+  // Programs dropped from the catalog.
+  for (int program_id = count; program_id < SYNC_MAX_PROGRAMS && persist_exists(SYNC_PROGRAM_KEY + program_id); program_id++){
+    persist_delete(SYNC_PROGRAM_KEY + program_id);
+  }
+
+  persist_write_data(SYNC_STATE_KEY, &state, sizeof(state));
+  LOG_INFO("sync: catalog of %d programs stored", count);
+
+  if (sync.handler){
+    sync.handler();
+  }
+}
+
+// The catalog does not fit in storage: give it up until the phone has
+// another one.
+static void sync_refuse(){
+  LOG_WARNING("sync: catalog of %d programs over %d bytes refused", sync_manifest_header()->program_count, (int)SYNC_STORED_BUDGET);
+  sync.refused_hash = sync.phone_hash;
+  sync_stop();
+}
+
+// Ask for the next program that differs from the manifest, or commit.
+static void sync_next(){
+  uint32_t hash;
+
+  for (; sync.next_program < sync_manifest_header()->program_count; sync.next_program++){
+    if (!sync_stored_hash(sync.next_program, &hash) || hash != sync_manifest_hash(sync.next_program)){
+      sync_begin_blob(sync.next_program);
+      return;
+    }
+    if (!sync_within_budget(persist_get_size(SYNC_PROGRAM_KEY + sync.next_program), sync.next_program + 1)){
+      sync_refuse();
+      return;
+    }
+    sync.stored += persist_get_size(SYNC_PROGRAM_KEY + sync.next_program);
+  }
+  sync_commit();
+}
+
+static void sync_blob_complete(){
+  if (sync.blob == SYNC_BLOB_MANIFEST){
+    if (!sync_manifest_valid()){
+      LOG_WARNING("sync: bad manifest");
+      sync_stop();
+      return;
+    }
+    sync.next_program = 0;
+    sync.stored = 0;
+    if (!sync_within_budget(0, 0)){
+      sync_refuse();
+      return;
+    }
+    sync_next();
+    return;
+  }
+
+  sync_program.hash = sync_manifest_hash(sync.blob);
+  if (sync_crc32(0, sync_program.blob, sync.size) != sync_program.hash){
+    // The phone's catalog changed under us, it says hello again.
+    LOG_WARNING("sync: program %d does not match the manifest", sync.blob);
+    sync_stop();
+    return;
+  }
+  if (!sync_within_budget(sizeof(sync_program.hash) + sync.size, sync.blob + 1)){
+    sync_refuse();
+    return;
+  }
+
+  // The stored manifest does not describe the programs any more once one
+  // is replaced: the menus go back to the resource until the commit.
+  if (sync_catalog_stored()){
+    persist_delete(SYNC_STATE_KEY);
+    if (sync.handler){
+      sync.handler();
+    }
+  }
+  if (persist_write_data(SYNC_PROGRAM_KEY + sync.blob, &sync_program, sizeof(sync_program.hash) + sync.size) < 0){
+    LOG_ERROR("sync: cannot store program %d", sync.blob);
+    sync_stop();
+    return;
+  }
+  sync.stored += sizeof(sync_program.hash) + sync.size;
+  sync.next_program = sync.blob + 1;
+  sync_next();
+}
+
+// PebbleKit JS sends every integer as 4 bytes, the watch as it was written.
+static uint32_t sync_tuple_uint(DictionaryIterator *iter, uint32_t key){
+  Tuple *tuple = dict_find(iter, key);
+
+  if (!tuple){
+    return 0;
+  }
+  switch (tuple->length){
+    case 1: return tuple->value->uint8;
+    case 2: return tuple->value->uint16;
+    default: return tuple->value->uint32;
+  }
+}
+
+static void sync_hello(uint32_t hash){
+  struct sync_state state;
+
+  if (persist_read_data(SYNC_STATE_KEY, &state, sizeof(state)) == sizeof(state) && state.manifest_hash == hash){
+    LOG_DEBUG("sync: catalog up to date");
+    sync_stop();
+    return;
+  }
+  if (hash == sync.refused_hash){
+    LOG_DEBUG("sync: catalog still over budget");
+    sync_stop();
+    return;
+  }
+  sync.phone_hash = hash;
+  sync_begin_blob(SYNC_BLOB_MANIFEST);
+}
+
+static void sync_chunk(DictionaryIterator *iter){
+  Tuple *data = dict_find(iter, SYNC_KEY_DATA);
+  uint16_t offset = sync_tuple_uint(iter, SYNC_KEY_OFFSET);
+  uint32_t size = sync_tuple_uint(iter, SYNC_KEY_SIZE);
+  uint16_t length = data ? data->length : 0;
+  uint8_t *buffer = sync.blob == SYNC_BLOB_MANIFEST ? sync_manifest : sync_program.blob;
+  size_t capacity = sync.blob == SYNC_BLOB_MANIFEST ? sizeof(sync_manifest) : sizeof(sync_program.blob);
+
+  // Leftovers of a stream we asked to restart.
+  if (!sync.active || sync_tuple_uint(iter, SYNC_KEY_BLOB) != sync.blob || offset < sync.received){
+    return;
+  }
+  if (size == 0 || size > capacity){
+    LOG_WARNING("sync: blob %d of %d bytes refused", sync.blob, (int)size);
+    sync_stop();
+    return;
+  }
+
+  // A gap or a bad chunk: ask again from where we are, once per gap.
+  if (offset != sync.received || !data || offset + length > size ||
+      sync_crc32(0, data->value->data, length) != sync_tuple_uint(iter, SYNC_KEY_CRC)){
+    if (offset == sync.received || sync.asked != sync.received){
+      sync_ask();
+    }
+    return;
+  }
+
+  memcpy(buffer + offset, data->value->data, length);
+  sync.received += length;
+  sync.size = size;
+  sync_keep_alive();
+
+  if (sync.received == sync.size){
+    sync_blob_complete();
+  }
+}
+
+static void sync_inbox_received(DictionaryIterator *iter, void *context){
+  switch (sync_tuple_uint(iter, SYNC_KEY_OP)){
+    case SYNC_OP_HELLO:
+      sync_hello(sync_tuple_uint(iter, SYNC_KEY_CRC));
+      break;
+    case SYNC_OP_CHUNK:
+      sync_chunk(iter);
+      break;
+  }
+}
+
+// A request that did not go out is sent again, or once the outbox is free.
+static void sync_outbox_sent(DictionaryIterator *iter, void *context){
+  if (sync.active && sync.ask_pending){
+    sync_ask();
+  }
+}
+
+static void sync_outbox_failed(DictionaryIterator *iter, AppMessageResult reason, void *context){
+  if (sync.active){
+    sync_ask();
+  }
+}
+
+// Open AppMessage and wait for the phone's hello.
+void sync_init(SyncHandler handler){
+  uint32_t inbox = app_message_inbox_size_maximum();
+
+  if (inbox > SYNC_INBOX_SIZE){
+    inbox = SYNC_INBOX_SIZE;
+  }
+
+  memset(&sync, 0, sizeof(sync));
+  sync.handler = handler;
+  sync.chunk_size = inbox - dict_calc_buffer_size(6, 4, 4, 4, 4, 4, 0);
+
+  app_message_register_inbox_received(sync_inbox_received);
+  app_message_register_outbox_sent(sync_outbox_sent);
+  app_message_register_outbox_failed(sync_outbox_failed);
+  app_message_open(inbox, SYNC_OUTBOX_SIZE);
+}
+
+void sync_deinit(){
+  sync_stop();
+  app_message_deregister_callbacks();
+}
+
+// True while a transfer is under way.
+bool sync_active(){
+  return sync.active;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "pebble.h"
+#include "catalog.h"
+#include "session.h"
+
+// Catalog sync with the phone (src/sync.js) over AppMessage.
+//
+// The phone holds the catalog as a manifest and one blob per program:
+//   manifest  struct catalog_header, the menu records, then the u32 hash of
+//             every program
+//   program   struct catalog_program (first_op zero) followed by its ops
+// A program's hash is the CRC-32 of its blob.
+//
+// The phone says hello with the hash of its manifest whenever it is ready
+// or its catalog changed. If the watch has another one, it asks for the
+// manifest, then for every program whose stored hash differs, one blob at a
+// time. The phone streams a blob in chunks sized to our inbox, each with
+// the CRC-32 of its data; a bad or missing chunk makes the watch ask again
+// from where it is. Programs are stored as they complete, so a transfer
+// that is cut off picks up after the last complete program on the next
+// hello. The manifest is stored last and only then feeds the menus; the
+// catalog stored before stops feeding them as the first program comes in,
+// so a transfer cut off leaves the menus on the resource, never on an old
+// manifest over new programs.
+#define SYNC_VERSION 1
+
+// AppMessage keys, see appKeys in appinfo.json.
+#define SYNC_KEY_OP 0
+#define SYNC_KEY_BLOB 1
+#define SYNC_KEY_OFFSET 2
+#define SYNC_KEY_SIZE 3
+#define SYNC_KEY_CRC 4
+#define SYNC_KEY_DATA 5
+
+enum sync_op {
+  SYNC_OP_HELLO = 1,  // Phone: crc is the hash of its manifest.
+  SYNC_OP_REQUEST,    // Watch: send blob from offset, chunks of size bytes.
+  SYNC_OP_CHUNK,      // Phone: data of blob at offset, size is the blob's.
+};
+
+// Blob number of the manifest, programs go by their catalog number.
+#define SYNC_BLOB_MANIFEST 0xFFFF
+
+// Persist keys: the manifest's hash and size, written last, the manifest in
+// pages, and one key per program holding its hash and blob.
+#define SYNC_STATE_KEY 32
+#define SYNC_MANIFEST_KEY 33
+#define SYNC_MANIFEST_PAGES 2
+#define SYNC_PROGRAM_KEY 64
+#define SYNC_MAX_PROGRAMS 64
+
+#define SYNC_MANIFEST_MAX (SYNC_MANIFEST_PAGES * PERSIST_DATA_MAX_LENGTH)
+#define SYNC_PROGRAM_MAX (sizeof(struct catalog_program) + PROGRAM_MAX_OPS * sizeof(uint16_t))
+
+// What a program takes in storage at least: its hash, record and one op.
+#define SYNC_PROGRAM_MIN_STORED (sizeof(uint32_t) + sizeof(struct catalog_program) + sizeof(uint16_t))
+
+// An app gets 4 KB of persistent storage. The synced catalog, its manifest
+// and programs, gets what the history ring, the session, the reminders and
+// the sync state leave. A catalog over it is refused: from its manifest
+// when even programs of one op would not fit, or as soon as a program
+// would take it over. The bundled resource has no such limit.
+#define SYNC_PERSIST_LIMIT 4096
+#define SYNC_STORED_BUDGET (SYNC_PERSIST_LIMIT - HISTORY_SLOTS * sizeof(struct history_record) - \
+                            sizeof(struct session) - REMINDERS_MAX * sizeof(struct reminder) - \
+                            sizeof(struct sync_state))
+
+// Inbox we ask for; the chunks are sized to whatever we get.
+#define SYNC_INBOX_SIZE 256
+#define SYNC_OUTBOX_SIZE 64
+
+// A transfer with no chunk for this long is given up until the next hello.
+#define SYNC_TIMEOUT_MS 10000
+
+struct sync_state {
+    uint32_t manifest_hash;
+    uint16_t manifest_size;
+    uint16_t reserved;
+};
+
+// Called when the catalog to show changed: a new one was stored, or the
+// old one given up for the resource as a new one comes in.
+typedef void (*SyncHandler)();
+
+void sync_init(SyncHandler handler);
+void sync_deinit();
+bool sync_active();
+
+bool sync_catalog_stored();
+bool sync_read_manifest(uint32_t offset, void *buffer, size_t size);
+bool sync_read_program(int program_id, uint32_t offset, void *buffer, size_t size);
+
+uint32_t sync_crc32(uint32_t crc, const void *data, size_t size);
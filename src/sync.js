@@ -0,0 +1,260 @@
+// Catalog sync, phone side. See src/sync.h for the protocol and the blob
+// layouts, and host/phone.c for the same in C.
+//
+// The catalog is kept in localStorage in the format of resources/programs.json
+// and edited from the configuration page. When the app is ready, and when
+// the catalog changes, we say hello with the hash of our manifest; the watch
+// asks for whatever it is missing, one blob at a time, and we stream each
+// blob in chunks of the size it asks for.
+
+var SYNC_OP_HELLO = 1;
+var SYNC_OP_REQUEST = 2;
+var SYNC_OP_CHUNK = 3;
+var SYNC_BLOB_MANIFEST = 0xFFFF;
+var SYNC_MAX_PROGRAMS = 64;
+
+// Must match src/catalog.h, src/program.h and tools/pack_programs.py.
+var CATALOG_VERSION = 2;
+var TITLE_SIZE = 10;
+var SUBTITLE_SIZE = 20;
+var ARG_BITS = 13;
+var MAX_ARG = (1 << ARG_BITS) - 1;
+var MAX_OPS = 64;
+var OP_REPEAT = 5;
+var OP_END = 6;
+// Longest interval the timer shows, 99:59, see src/digits.h. Must match
+// PROGRAM_MAX_SEGMENT_S in src/program.h.
+var MAX_SECONDS = 99 * 60 + 59;
+var INTERVAL_TYPES = {
+  run: 0,
+  walk: 1,
+  periodic: 2,
+  warmup: 3,
+  cooldown: 4
+};
+
+var packed = null;
+var stream = null;
+var sending = false;
+
+function crc32(bytes) {
+  var crc = 0xFFFFFFFF;
+
+  for (var i = 0; i < bytes.length; i++) {
+    crc ^= bytes[i];
+    for (var bit = 0; bit < 8; bit++) {
+      crc = (crc >>> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+  }
+  return (~crc) >>> 0;
+}
+
+function u16(value) {
+  return [value & 0xFF, (value >>> 8) & 0xFF];
+}
+
+function u32(value) {
+  return u16(value & 0xFFFF).concat(u16(value >>> 16));
+}
+
+function text(value, size) {
+  var utf8 = unescape(encodeURIComponent(value));
+  var bytes = [];
+
+  if (utf8.length >= size) {
+    throw new Error("'" + value + "' does not fit in " + (size - 1) + ' bytes');
+  }
+  for (var i = 0; i < size; i++) {
+    bytes.push(i < utf8.length ? utf8.charCodeAt(i) : 0);
+  }
+  return bytes;
+}
+
+function op(code, arg) {
+  if (!(arg >= 0 && arg <= MAX_ARG)) {
+    throw new Error('argument ' + arg + ' out of range');
+  }
+  return (code << ARG_BITS) | arg;
+}
+
+function segment(entry) {
+  if (!(entry[0] in INTERVAL_TYPES)) {
+    throw new Error('unknown interval type ' + entry[0]);
+  }
+  if (!(entry[1] === Math.floor(entry[1]) && entry[1] >= 1 && entry[1] <= MAX_SECONDS)) {
+    throw new Error(entry[0] + ' interval of ' + entry[1] + ' seconds, 1 to ' + MAX_SECONDS);
+  }
+  return op(INTERVAL_TYPES[entry[0]], entry[1]);
+}
+
+// Same rules as compile_program in tools/pack_programs.py.
+function compileProgram(program) {
+  var ops = [];
+  var entries = program.intervals;
+
+  if (!entries.length) {
+    throw new Error(program.title + ': no intervals');
+  }
+  entries.forEach(function (entry, i) {
+    var times;
+
+    if (Array.isArray(entry)) {
+      ops.push(segment(entry));
+      return;
+    }
+    if (!entry.intervals.length || entry.intervals.some(function (inner) { return !Array.isArray(inner); })) {
+      throw new Error(program.title + ': repeat needs a flat, non-empty body');
+    }
+    if (entry.repeat === 'forever') {
+      if (i !== entries.length - 1) {
+        throw new Error(program.title + ': nothing can follow a forever repeat');
+      }
+      times = 0;
+    } else if (entry.repeat === Math.floor(entry.repeat) && entry.repeat >= 1 && entry.repeat <= MAX_ARG) {
+      times = entry.repeat;
+    } else {
+      throw new Error(program.title + ': bad repeat count ' + entry.repeat);
+    }
+
+    ops.push(op(OP_REPEAT, times));
+    ops = ops.concat(entry.intervals.map(segment));
+    ops.push(op(OP_END, 0));
+  });
+
+  if (ops.length > MAX_OPS) {
+    throw new Error(program.title + ': ' + ops.length + ' ops, at most ' + MAX_OPS);
+  }
+  return ops;
+}
+
+// Packs a catalog into the manifest and one blob per program.
+function packCatalog(catalog) {
+  var menus = [];
+  var programs = [];
+  var hashes = [];
+
+  catalog.menus.forEach(function (menu) {
+    menus = menus.concat(text(menu.title, TITLE_SIZE), text(menu.subtitle, SUBTITLE_SIZE),
+                         u16(programs.length), [menu.programs.length, 0]);
+
+    menu.programs.forEach(function (program) {
+      var blob = text(program.title, TITLE_SIZE).concat(text(program.subtitle, SUBTITLE_SIZE));
+      var ops = compileProgram(program);
+
+      blob = blob.concat(u16(0), u16(ops.length));
+      ops.forEach(function (word) {
+        blob = blob.concat(u16(word));
+      });
+      programs.push(blob);
+      hashes = hashes.concat(u32(crc32(blob)));
+    });
+  });
+
+  if (programs.length > SYNC_MAX_PROGRAMS) {
+    throw new Error(programs.length + ' programs, at most ' + SYNC_MAX_PROGRAMS);
+  }
+
+  return {
+    manifest: [82, 67, CATALOG_VERSION, catalog.menus.length].concat(u16(programs.length), u16(0), menus, hashes),
+    programs: programs
+  };
+}
+
+function loadCatalog() {
+  var json = localStorage.getItem('catalog');
+
+  if (!json) {
+    return null;
+  }
+  try {
+    return packCatalog(JSON.parse(json));
+  } catch (e) {
+    console.log('sync: bad catalog, ' + e.message);
+    return null;
+  }
+}
+
+// One message in flight at a time; its ack sends the next chunk.
+function send(message) {
+  sending = true;
+  Pebble.sendAppMessage(message, function () {
+    sending = false;
+    pump();
+  }, function () {
+    // The watch asks again from where it is.
+    sending = false;
+    stream = null;
+  });
+}
+
+function pump() {
+  var blob, data, message;
+
+  if (sending || !stream) {
+    return;
+  }
+
+  blob = stream.blob === SYNC_BLOB_MANIFEST ? packed.manifest : packed.programs[stream.blob];
+  blob = blob || [];
+  data = blob.slice(stream.offset, stream.offset + stream.size);
+  message = {
+    op: SYNC_OP_CHUNK,
+    blob: stream.blob,
+    offset: stream.offset,
+    size: blob.length,
+    crc: crc32(data) | 0
+  };
+  if (data.length) {
+    message.data = data;
+  }
+
+  stream.offset += data.length;
+  if (stream.offset >= blob.length) {
+    stream = null;
+  }
+  send(message);
+}
+
+function hello() {
+  packed = loadCatalog();
+  if (packed && !sending) {
+    send({ op: SYNC_OP_HELLO, crc: crc32(packed.manifest) | 0 });
+  }
+}
+
+Pebble.addEventListener('ready', hello);
+
+Pebble.addEventListener('appmessage', function (e) {
+  if (e.payload.op !== SYNC_OP_REQUEST || !packed) {
+    return;
+  }
+  stream = { blob: e.payload.blob, offset: e.payload.offset, size: e.payload.size || 1 };
+  pump();
+});
+
+// The configuration page is a text area holding the catalog as JSON.
+Pebble.addEventListener('showConfiguration', function () {
+  var catalog = localStorage.getItem('catalog') || '{"menus": []}';
+  var page = '<!DOCTYPE html><html><body>' +
+    '<textarea id="c" style="width:100%;height:80vh">' + catalog.replace(/&/g, '&amp;').replace(/</g, '&lt;') + '</textarea>' +
+    '<button onclick="location.href=\'pebblejs://close#\'+encodeURIComponent(document.getElementById(\'c\').value)">Save</button>' +
+    '</body></html>';
+
+  Pebble.openURL('data:text/html,' + encodeURIComponent(page));
+});
+
+Pebble.addEventListener('webviewclosed', function (e) {
+  var json = e.response ? decodeURIComponent(e.response) : '';
+
+  if (!json) {
+    return;
+  }
+  try {
+    packCatalog(JSON.parse(json));
+  } catch (err) {
+    console.log('sync: catalog refused, ' + err.message);
+    return;
+  }
+  localStorage.setItem('catalog', json);
+  hello();
+});
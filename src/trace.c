@@ -0,0 +1,56 @@
+#include "pebble.h"
+#include "trace.h"
+
+#if TRACE_SIZE > 0
+
+static struct trace_record trace_buffer[TRACE_SIZE];
+
+// Records written so far, the oldest ones are overwritten.
+static uint32_t trace_count = 0;
+
+static const char *trace_event_names[TRACE_EVENT_COUNT] = {
+  [TRACE_START] = "start",
+  [TRACE_BOUNDARY] = "boundary",
+  [TRACE_NEXT] = "next",
+  [TRACE_PREVIOUS] = "previous",
+  [TRACE_PAUSE] = "pause",
+  [TRACE_RESUME] = "resume",
+  [TRACE_DONE] = "done",
+  [TRACE_TICK_MODE] = "tick mode",
+  [TRACE_RESTORE] = "restore",
+  [TRACE_SEEK] = "seek",
+  [TRACE_AUTO_PAUSE] = "auto pause",
+  [TRACE_AUTO_RESUME] = "auto resume",
+  [TRACE_REMINDER] = "reminder",
+  [TRACE_LOW_POWER] = "low power",
+};
+
+// Record an event.
+void trace(enum trace_event event, uint16_t payload){
+  struct trace_record *record = &trace_buffer[trace_count % TRACE_SIZE];
+  time_t seconds;
+  uint16_t ms;
+
+  time_ms(&seconds, &ms);
+  record->timestamp = (uint32_t)seconds * 1000 + ms;
+  record->event = event;
+  record->payload = payload;
+  trace_count++;
+}
+
+// Log the buffer, oldest record first, with times relative to it. This is
+// the only place trace records get formatted.
+void trace_dump(){
+  uint32_t first = trace_count > TRACE_SIZE ? trace_count - TRACE_SIZE : 0;
+  uint32_t origin = trace_buffer[first % TRACE_SIZE].timestamp;
+
+  APP_LOG(APP_LOG_LEVEL_INFO, "trace: %lu records, %lu dropped", (unsigned long)(trace_count - first), (unsigned long)first);
+  for (uint32_t i = first; i < trace_count; i++){
+    struct trace_record *record = &trace_buffer[i % TRACE_SIZE];
+    const char *name = record->event < TRACE_EVENT_COUNT ? trace_event_names[record->event] : NULL;
+
+    APP_LOG(APP_LOG_LEVEL_INFO, "trace: +%lu ms %s %u", (unsigned long)(record->timestamp - origin), name ? name : "?", record->payload);
+  }
+}
+
+#endif
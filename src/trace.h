@@ -0,0 +1,48 @@
+#pragma once
+
+#include "pebble.h"
+
+// Trace ring buffer: a fixed number of small binary records kept in RAM and
+// only formatted when dumped, so recording an event costs a few stores.
+// Set TRACE_SIZE to 0 to compile tracing out.
+#ifndef TRACE_SIZE
+#define TRACE_SIZE 64
+#endif
+
+enum trace_event {
+  TRACE_START = 1,   // Program started, payload: intervals total.
+  TRACE_BOUNDARY,    // Deadline reached, payload: new interval index.
+  TRACE_NEXT,        // Skipped forward, payload: new interval index.
+  TRACE_PREVIOUS,    // Skipped back, payload: new interval index.
+  TRACE_PAUSE,       // Paused, payload: interval index.
+  TRACE_RESUME,      // Resumed, payload: seconds spent paused.
+  TRACE_DONE,        // Program over, payload: intervals total.
+  TRACE_TICK_MODE,   // Tick resolution changed, payload: TimeUnits.
+  TRACE_RESTORE,     // Picked up a saved session, payload: interval index.
+  TRACE_SEEK,        // Scrubbed, payload: new interval index.
+  TRACE_AUTO_PAUSE,  // Wearer stopped, payload: interval index.
+  TRACE_AUTO_RESUME, // Wearer moved again, payload: interval index.
+  TRACE_REMINDER,    // Reminder went off, payload: its slot.
+  TRACE_LOW_POWER,   // Low power mode switched, payload: 1 on, 0 off.
+  TRACE_EVENT_COUNT
+};
+
+struct trace_record {
+  // Low 32 bits of the clock in milliseconds.
+  uint32_t timestamp;
+
+  // enum trace_event.
+  uint8_t event;
+  uint8_t reserved;
+
+  // Event specific.
+  uint16_t payload;
+};
+
+#if TRACE_SIZE > 0
+void trace(enum trace_event event, uint16_t payload);
+void trace_dump();
+#else
+#define trace(event, payload) do {} while (0)
+#define trace_dump() do {} while (0)
+#endif
@@ -0,0 +1,78 @@
+#!/usr/bin/env python
+#
+# Reports what an ELF takes of the app's RAM: .text (code and read-only
+# data), .data and .bss, per symbol from nm and in total, and checks the
+# totals against a budget. On aplite all three are loaded into the app's
+# 24 KB together with its heap, so --ram bounds their sum.
+#
+# Exits with 1 when a total is over its budget, 2 when nm fails.
+#
+# Usage: footprint.py [--nm NM] [--top N] [--text B] [--data B] [--bss B]
+#                     [--ram B] pebble-app.elf
+
+import argparse
+import subprocess
+import sys
+
+# nm symbol types, by section.
+SECTIONS = {
+    'text': 'tTrR',
+    'data': 'dDgG',
+    'bss': 'bBsSC',
+}
+
+
+def symbols(nm, elf):
+    """(section, size, name) of every sized symbol in the ELF."""
+    try:
+        out = subprocess.check_output([nm, '--size-sort', '-S', '-t', 'd', elf])
+    except (OSError, subprocess.CalledProcessError) as e:
+        sys.stderr.write('footprint: %s failed: %s\n' % (nm, e))
+        sys.exit(2)
+
+    found = []
+    for line in out.decode('ascii', 'replace').splitlines():
+        fields = line.split()
+        if len(fields) < 4:
+            continue
+        size, kind, name = int(fields[1]), fields[2], fields[3]
+        for section, kinds in SECTIONS.items():
+            if kind in kinds:
+                found.append((section, size, name))
+    return found
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Footprint of an ELF against a budget.')
+    parser.add_argument('elf')
+    parser.add_argument('--nm', default='arm-none-eabi-nm')
+    parser.add_argument('--top', type=int, default=10, help='largest symbols shown per section')
+    for section in ('text', 'data', 'bss', 'ram'):
+        parser.add_argument('--' + section, type=int, help='budget in bytes')
+    args = parser.parse_args()
+
+    found = symbols(args.nm, args.elf)
+    totals = dict((section, 0) for section in SECTIONS)
+    over = False
+
+    for section in ('text', 'data', 'bss'):
+        mine = sorted([s for s in found if s[0] == section], key=lambda s: -s[1])
+        totals[section] = sum(s[1] for s in mine)
+        print('%s: %d bytes in %d symbols' % (section, totals[section], len(mine)))
+        for _, size, name in mine[:args.top]:
+            print('  %6d  %s' % (size, name))
+    totals['ram'] = totals['text'] + totals['data'] + totals['bss']
+
+    for section in ('text', 'data', 'bss', 'ram'):
+        budget = getattr(args, section)
+        if budget is None:
+            continue
+        status = 'ok' if totals[section] <= budget else 'OVER'
+        over = over or totals[section] > budget
+        print('%-4s %6d of %6d bytes, %s' % (section, totals[section], budget, status))
+
+    return 1 if over else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,194 @@
+#!/usr/bin/env python
+#
+# Packs the workout catalog (resources/programs.json) into the binary
+# resource the watch loads program by program (resources/data/programs.bin).
+#
+# Layout, little endian, see src/catalog.h:
+#   header   'RC', version u8, menu count u8, program count u16, reserved u16
+#   menus    title[10], subtitle[20], first program u16, program count u8, flags u8
+#   programs title[10], subtitle[20], first op u16, op count u16
+#   ops      u16 each, workout bytecode, see src/program.h
+#
+# A program's "intervals" list holds [type, seconds] pairs and repeat blocks,
+# {"repeat": n, "intervals": [...]} with n a count or "forever". Repeats do
+# not nest and a "forever" block must come last. Every interval lasts 1 to
+# 5999 seconds, 99:59 on the watch's two minute digits, and every program
+# has at least one; the build fails on a catalog that breaks any of this,
+# with a line per problem.
+#
+# Usage: pack_programs.py [catalog.json [programs.bin]]
+
+import json
+import os
+import struct
+import sys
+
+VERSION = 2
+
+TITLE_SIZE = 10
+SUBTITLE_SIZE = 20
+
+# Must match INTERVAL_TYPE_* in src/resources.h.
+INTERVAL_TYPES = {
+    'run': 0,
+    'walk': 1,
+    'periodic': 2,
+    'warmup': 3,
+    'cooldown': 4,
+}
+
+# Must match the u8 counts of src/catalog.h.
+MAX_MENUS = 255
+MAX_MENU_PROGRAMS = 255
+
+# Must match src/program.h.
+ARG_BITS = 13
+MAX_ARG = (1 << ARG_BITS) - 1
+MAX_OPS = 64
+OP_REPEAT = 5
+OP_END = 6
+
+# Longest interval the timer shows, 99:59, see src/digits.h. Must match
+# PROGRAM_MAX_SEGMENT_S in src/program.h; the ops could hold up to MAX_ARG
+# seconds.
+MAX_SECONDS = 99 * 60 + 59
+
+
+class CatalogError(ValueError):
+    pass
+
+
+def text(value, size):
+    data = value.encode('utf-8')
+    if len(data) >= size:
+        raise CatalogError("'%s' does not fit in %d bytes" % (value, size - 1))
+    return data + b'\0' * (size - len(data))
+
+
+def op(code, arg):
+    if not 0 <= arg <= MAX_ARG:
+        raise CatalogError('argument %d out of range' % arg)
+    return (code << ARG_BITS) | arg
+
+
+def is_count(value):
+    return isinstance(value, int) and not isinstance(value, bool)
+
+
+def segment(entry):
+    if not isinstance(entry, list) or len(entry) != 2:
+        raise CatalogError('%r is not a [type, seconds] pair' % (entry,))
+    kind, duration = entry
+    if kind not in INTERVAL_TYPES:
+        raise CatalogError("unknown interval type '%s', one of %s" % (kind, ', '.join(sorted(INTERVAL_TYPES))))
+    if not is_count(duration) or not 1 <= duration <= MAX_SECONDS:
+        raise CatalogError('%s interval of %r seconds, 1 to %d' % (kind, duration, MAX_SECONDS))
+    return op(INTERVAL_TYPES[kind], duration)
+
+
+def compile_program(program):
+    ops = []
+    entries = program['intervals']
+
+    if not entries:
+        raise CatalogError('no intervals')
+
+    for i, entry in enumerate(entries):
+        if not isinstance(entry, dict):
+            ops.append(segment(entry))
+            continue
+
+        body = entry['intervals']
+        if not body or any(isinstance(inner, dict) for inner in body):
+            raise CatalogError('repeat needs a flat, non-empty body')
+        if entry['repeat'] == 'forever':
+            if i != len(entries) - 1:
+                raise CatalogError('nothing can follow a forever repeat')
+            times = 0
+        elif is_count(entry['repeat']) and 1 <= entry['repeat'] <= MAX_ARG:
+            times = entry['repeat']
+        else:
+            raise CatalogError('bad repeat count %r' % (entry['repeat'],))
+
+        ops.append(op(OP_REPEAT, times))
+        ops += [segment(inner) for inner in body]
+        ops.append(op(OP_END, 0))
+
+    if len(ops) > MAX_OPS:
+        raise CatalogError('%d ops, at most %d' % (len(ops), MAX_OPS))
+    return ops
+
+
+def pack(catalog):
+    """The packed catalog. Checks all of it first, and raises CatalogError
+    with one line per problem found, each with the menu and program."""
+    menus = b''
+    programs = b''
+    ops = []
+    program_count = 0
+    errors = []
+
+    def check(where, fun, *args):
+        try:
+            return fun(*args)
+        except (CatalogError, KeyError, TypeError) as e:
+            reason = 'missing %s' % e if isinstance(e, KeyError) else e
+            errors.append('%s: %s' % (where, reason))
+
+    if not 1 <= len(catalog['menus']) <= MAX_MENUS:
+        errors.append('%d menus, 1 to %d' % (len(catalog['menus']), MAX_MENUS))
+
+    for menu in catalog['menus']:
+        where = menu.get('title', '?')
+        if not 1 <= len(menu['programs']) <= MAX_MENU_PROGRAMS:
+            errors.append('%s: %d programs, 1 to %d' % (where, len(menu['programs']), MAX_MENU_PROGRAMS))
+        menus += check(where, text, menu['title'], TITLE_SIZE) or b''
+        menus += check(where, text, menu['subtitle'], SUBTITLE_SIZE) or b''
+        menus += struct.pack('<HBB', program_count & 0xFFFF, len(menu['programs']) & 0xFF, 0)
+
+        for program in menu['programs']:
+            where = '%s / %s %s' % (menu['title'], program.get('title', '?'), program.get('subtitle', ''))
+            programs += check(where, text, program['title'], TITLE_SIZE) or b''
+            programs += check(where, text, program['subtitle'], SUBTITLE_SIZE) or b''
+            code = check(where, compile_program, program) or []
+            programs += struct.pack('<HH', len(ops) & 0xFFFF, len(code))
+            ops += code
+            program_count += 1
+
+    # Record fields are 16 bits.
+    if program_count > 0xFFFF or len(ops) > 0xFFFF:
+        errors.append('%d programs and %d ops, at most 65535 each' % (program_count, len(ops)))
+    if errors:
+        raise CatalogError('\n'.join(errors))
+
+    header = struct.pack('<2sBBHH', b'RC', VERSION, len(catalog['menus']), program_count, 0)
+    return header + menus + programs + struct.pack('<%dH' % len(ops), *ops)
+
+
+def main(argv):
+    root = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+    source = argv[1] if len(argv) > 1 else os.path.join(root, 'resources', 'programs.json')
+    target = argv[2] if len(argv) > 2 else os.path.join(root, 'resources', 'data', 'programs.bin')
+
+    try:
+        with open(source) as f:
+            data = pack(json.load(f))
+    except (ValueError, KeyError, TypeError) as e:
+        reason = 'missing %s' % e if isinstance(e, KeyError) else e
+        for line in str(reason).splitlines():
+            sys.stderr.write('%s: %s\n' % (os.path.normpath(source), line))
+        return 1
+
+    # Left alone when unchanged, so that the resources are not rebuilt.
+    if os.path.exists(target):
+        with open(target, 'rb') as f:
+            if f.read() == data:
+                return 0
+    with open(target, 'wb') as f:
+        f.write(data)
+    print('%s: %d bytes' % (os.path.normpath(target), len(data)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,116 @@
+#!/usr/bin/env python
+"""Writes synthetic wrist accelerometer traces for the host simulator.
+
+    tools/synth_accel.py [out_dir]
+
+Each trace is a CSV of x,y,z in mg at the rate of the cadence engine (see
+src/cadence.h), with '#' comment lines giving the rate and the reference
+cadence, i.e. the steps generated divided by the minutes, and the stretches
+where the wearer stands still. Recorded traces go in the same format, their
+reference counted by hand or by a foot pod.
+
+The model: every step is a short vertical impact, the arm swings once per
+stride, gravity sits on a slowly drifting wrist, and there is sensor noise.
+It is rendered at 1 kHz, averaged over the accelerometer's bandwidth and
+decimated, like the sensor does. Seeded, so the files are reproducible.
+"""
+
+import math
+import os
+import random
+import sys
+
+RENDER_HZ = 1000
+RATE_HZ = 25
+
+# name: seconds, [(from_s, cadence_spm, impact_mg, swing_mg)]; cadence 0
+# is standing still.
+TRACES = {
+    'run_172': (180, [(0, 172, 900, 500)]),
+    'run_158': (180, [(0, 158, 800, 450)]),
+    'walk_116': (180, [(0, 116, 350, 300)]),
+    'still': (120, [(0, 0, 0, 0)]),
+    # Stop and go: traffic lights, and a walk.
+    'stop_go': (300, [(0, 165, 850, 480), (60, 0, 0, 0), (90, 165, 850, 480), (150, 0, 0, 0),
+                      (170, 116, 350, 300), (230, 0, 0, 0), (250, 165, 850, 480)]),
+}
+
+
+def phases(plan, duration):
+    """(start, end, cadence, impact, swing) for every part of the plan."""
+    bounds = [p[0] for p in plan[1:]] + [duration]
+    return [(p[0], end) + tuple(p[1:]) for p, end in zip(plan, bounds)]
+
+
+def render(name, duration, plan, rng):
+    n = duration * RENDER_HZ
+    x = [0.0] * n
+    y = [0.0] * n
+    z = [0.0] * n
+    steps = 0
+
+    # Steps: a 60 ms half sine on the vertical axis, intervals jittered 3%.
+    for start, end, cadence, impact, swing in phases(plan, duration):
+        if cadence == 0:
+            continue
+        t = start + rng.uniform(0, 60.0 / cadence)
+        while t < end:
+            at = int(t * RENDER_HZ)
+            width = int(0.06 * RENDER_HZ)
+            for i in range(width):
+                if at + i < n:
+                    z[at + i] -= impact * math.sin(math.pi * i / width)
+            steps += 1
+            t += rng.gauss(60.0 / cadence, 0.03 * 60.0 / cadence)
+
+        # Arm swing, once per stride.
+        for i in range(int(start * RENDER_HZ), int(end * RENDER_HZ)):
+            s = i / float(RENDER_HZ)
+            x[i] += swing * math.sin(math.pi * s * cadence / 60.0)
+            y[i] += 0.3 * swing * math.sin(math.pi * s * cadence / 60.0 + 1.0)
+
+    # Gravity on a wrist that slowly turns.
+    for i in range(n):
+        s = i / float(RENDER_HZ)
+        tilt = 0.4 + 0.2 * math.sin(2 * math.pi * s / 37.0)
+        x[i] += 1000 * math.sin(tilt) * 0.3
+        y[i] += 1000 * math.sin(tilt)
+        z[i] += -1000 * math.cos(tilt)
+
+    # The sensor averages over its bandwidth, then we sample.
+    window = RENDER_HZ // RATE_HZ
+    rows = []
+    for start in range(0, n - window + 1, window):
+        sample = []
+        for axis in (x, y, z):
+            value = sum(axis[start:start + window]) / window + rng.gauss(0, 25)
+            sample.append(int(round(max(-4000, min(4000, value)))))
+        rows.append(sample)
+
+    reference = steps * 60.0 / duration
+    still = [(start, end) for start, end, cadence, _, _ in phases(plan, duration) if cadence == 0]
+    return rows, reference, still
+
+
+def main():
+    out_dir = sys.argv[1] if len(sys.argv) > 1 else os.path.join(os.path.dirname(__file__), '..', 'host', 'traces')
+    if not os.path.isdir(out_dir):
+        os.makedirs(out_dir)
+
+    for name in sorted(TRACES):
+        duration, plan = TRACES[name]
+        rows, reference, still = render(name, duration, plan, random.Random(name))
+        with open(os.path.join(out_dir, name + '.csv'), 'w') as f:
+            f.write('# Synthetic, tools/synth_accel.py\n')
+            f.write('# rate_hz %d\n' % RATE_HZ)
+            f.write('# cadence_spm %.1f\n' % reference)
+            for start, end in still:
+                f.write('# still_s %d %d\n' % (start, end))
+            f.write('x,y,z\n')
+            for row in rows:
+                f.write('%d,%d,%d\n' % tuple(row))
+        print('%s: %d samples, %.1f spm' % (name, len(rows), reference))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,54 @@
+#include "pebble_worker.h"
+#include "../src/background.h"
+
+// The workout's next alert while the app is closed, see src/background.h.
+// Nothing else of the workout is kept here: the app knows the rest when it
+// closes and works it out again from its session when it is launched.
+static AppTimer *launch_timer = NULL;
+
+// Cookie of the alert the timer is for, and of the one the app was last
+// launched for, 0 for none.
+static uint16_t alert_cookie = 0;
+static uint16_t launched_cookie = 0;
+
+static void launch_cancel(){
+  if (launch_timer){
+    app_timer_cancel(launch_timer);
+    launch_timer = NULL;
+  }
+}
+
+// The alert is close: bring the app up for it.
+static void launch_callback(void *data){
+  launch_timer = NULL;
+  launched_cookie = alert_cookie;
+  worker_launch_app();
+}
+
+static void message_handler(uint16_t type, AppWorkerMessage *message){
+  uint32_t in_ms;
+
+  switch (type){
+    case BACKGROUND_MSG_ALERT:
+      in_ms = (uint32_t)message->data0 << 16 | message->data1;
+      launch_cancel();
+      alert_cookie = message->data2;
+      launch_timer = app_timer_register(in_ms > BACKGROUND_LEAD_MS ? in_ms - BACKGROUND_LEAD_MS : 0, launch_callback, NULL);
+      break;
+
+    case BACKGROUND_MSG_STAND_DOWN:
+      launch_cancel();
+      app_worker_send_message(BACKGROUND_MSG_LAUNCHED, &(AppWorkerMessage){ .data0 = launched_cookie });
+      launched_cookie = 0;
+      break;
+  }
+}
+
+int main(void){
+  app_worker_message_subscribe(message_handler);
+  worker_event_loop();
+  launch_cancel();
+  app_worker_message_unsubscribe();
+
+  return 0;
+}